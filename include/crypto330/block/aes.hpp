@@ -13,16 +13,65 @@ public:
         AES256
     };
 
-    AES(Type type, const std::string & key, bool hex = false);
+    // Round implementation. Reference is the byte-wise textbook cipher kept for cross-checking,
+    // TTable fuses SubBytes, ShiftRows and MixColumns into 32-bit table lookups,
+    // AESNI uses the x86 AES instructions. Auto picks AESNI when the CPU supports it, TTable otherwise.
+    // Bitsliced is a constant-time engine without secret-indexed lookups; it works on 8 blocks at once,
+    // so it is meant for bulk ECB/CTR data.
+    enum class Engine {
+        Auto,
+        Reference,
+        TTable,
+        AESNI,
+        Bitsliced
+    };
+
+    AES(Type type, const std::string & key, bool hex = false, Engine engine = Engine::Auto);
+
+    Engine GetEngine() const;
 
 private:
 
     void BuildKeyExpansion();
 
+    void BuildWordKeyExpansion();
+
     void EncryptBlock(uint8_t *block) const override;
 
     void DecryptBlock(uint8_t *block) const override;
 
+    void EncryptBlocks(uint8_t *blocks, size_t n) const override;
+
+    void DecryptBlocks(uint8_t *blocks, size_t n) const override;
+
+    void EncryptBlockReference(uint8_t *block) const;
+
+    void DecryptBlockReference(uint8_t *block) const;
+
+    void EncryptBlockTTable(uint8_t *block) const;
+
+    void DecryptBlockTTable(uint8_t *block) const;
+
+    void EncryptBlocksTTable(uint8_t *blocks, size_t n) const;
+
+    void DecryptBlocksTTable(uint8_t *blocks, size_t n) const;
+
+    void BuildAesNiKeyExpansion();
+
+    void EncryptBlockAesNi(uint8_t *block) const;
+
+    void DecryptBlockAesNi(uint8_t *block) const;
+
+    void EncryptBlocksAesNi(uint8_t *blocks, size_t n) const;
+
+    void DecryptBlocksAesNi(uint8_t *blocks, size_t n) const;
+
+    void BuildBitslicedKeyExpansion();
+
+    void EncryptBlocksBitsliced(uint8_t *blocks, size_t n) const;
+
+    void DecryptBlocksBitsliced(uint8_t *blocks, size_t n) const;
+
     void AddRoundKey(uint8_t *block, uint32_t round) const;
 
     void SubBytes(uint8_t *block) const;
@@ -37,9 +86,21 @@ private:
 
     void InvMixColumns(uint8_t *block) const;
 
+    Engine engine;
+
     uint32_t key_words;
     uint32_t rounds;
 
     uint8_t key[32]{};
     uint8_t key_expansion[4 * (14 + 1)][4]{};
+
+    // Big-endian column words; decryption keys follow the equivalent inverse cipher layout
+    uint32_t encrypt_key_words[4 * (14 + 1)]{};
+    uint32_t decrypt_key_words[4 * (14 + 1)]{};
+
+    // AESIMC-transformed round keys for AESDEC, in decryption order
+    uint8_t aesni_decrypt_keys[14 + 1][16]{};
+
+    // Round keys spread over 8 bit planes, each plane byte is 0x00 or 0xff
+    uint8_t bitsliced_keys[14 + 1][8][16]{};
 };
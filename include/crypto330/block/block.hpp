@@ -1,26 +1,102 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <fstream>
 #include <string>
 #include <vector>
 
 class BlockEncryption {
 public:
+    // Largest block of any cipher (Kalyna 512), for fixed-size state buffers
+    static constexpr uint64_t MAX_BLOCK_BYTES = 64;
+
+    struct FileStats {
+        bool success = false;
+        uint64_t bytes = 0;
+        double seconds = 0;
+
+        // Megabytes of plaintext per second
+        double GetThroughput() const;
+    };
+
+    // Written in front of every encrypted file as the raw struct, so integers are in host byte order and
+    // files are only portable between little-endian hosts.
+    // Chunk i of the ciphertext starts at sizeof(FileHeader) + i * chunk_bytes, only the last chunk is padded.
+    struct FileHeader {
+        char magic[4];
+        uint16_t version;
+        uint16_t cipher_id;
+        // BlockStreamEncryption::Mode, files written by BlockEncryption are ECB
+        uint16_t mode;
+        uint16_t iv_bytes;
+        uint32_t reserved;
+        uint64_t length;
+        uint64_t chunk_bytes;
+        uint8_t iv[MAX_BLOCK_BYTES];
+
+        uint64_t GetChunkCount() const;
+    };
+
+    static constexpr uint16_t FILE_VERSION = 1;
+    static constexpr uint64_t DEFAULT_CHUNK_BYTES = 1024 * 1024 * 16;
+    static constexpr uint64_t MAX_CHUNK_BYTES = 1024 * 1024 * 256;
+
+    FileStats EncryptFile(const std::string &source, const std::string &destination,
+                          uint64_t chunk_bytes = DEFAULT_CHUNK_BYTES) const;
+
+    // Restores the exact original length
+    FileStats DecryptFile(const std::string &source, const std::string &destination) const;
+
+    // Decrypts chunks [first_chunk, first_chunk + chunks) only, seeking directly to the first one.
+    // Independent ranges can be decrypted concurrently.
+    FileStats DecryptFileChunks(const std::string &source, const std::string &destination,
+                                uint64_t first_chunk, uint64_t chunks) const;
+
+    // Header for a file of length plaintext bytes with this cipher, mode ECB and no IV
+    FileHeader CreateFileHeader(uint64_t length, uint64_t chunk_bytes) const;
+
+    // Reads and validates the header of a file written by EncryptFile
+    static bool ReadFileHeader(const std::string &path, FileHeader &header);
 
     void Decrypt(std::vector<uint8_t> &data) const;
 
     void Encrypt(std::vector<uint8_t> &data) const;
 
+    // Out-of-place versions, out may be the same buffer as in. Encrypt zero-pads to GetPaddedSize(length) bytes,
+    // Decrypt takes whole blocks. Both return the number of bytes written, or 0 if capacity is too small.
+    size_t Encrypt(const uint8_t *in, size_t length, uint8_t *out, size_t capacity) const;
+
+    size_t Decrypt(const uint8_t *in, size_t length, uint8_t *out, size_t capacity) const;
+
+    // length rounded up to whole blocks
+    size_t GetPaddedSize(size_t length) const;
+
     virtual void EncryptBlock(uint8_t *block) const = 0;
 
     virtual void DecryptBlock(uint8_t *block) const = 0;
 
+    // Process n consecutive blocks in place. Ciphers override these to interleave independent blocks,
+    // the default implementation calls EncryptBlock/DecryptBlock in a loop.
+    virtual void EncryptBlocks(uint8_t *blocks, size_t n) const;
+
+    virtual void DecryptBlocks(uint8_t *blocks, size_t n) const;
+
+    // Splits n blocks into batches processed by EncryptBlocks/DecryptBlocks on all OpenMP threads
+    void ProcessBlocksParallel(uint8_t *blocks, size_t n, bool encryption) const;
+
     uint64_t GetBlockBytes() const;
 
+    // Identifies the cipher and its parameters in file headers
+    uint16_t GetCipherId() const;
+
 protected:
     void ProcessData(std::vector<uint8_t> &data, bool encryption) const;
 
-    void ProcessFile(const std::string &source, const std::string &destination, bool encryption) const;
+    // Streams input_length bytes from in through the cipher and writes the first output_length bytes to out
+    FileStats ProcessFile(std::ifstream &in, std::ofstream &out, uint64_t input_length, uint64_t output_length,
+                          uint64_t chunk_bytes, bool encryption) const;
 
     uint64_t block_bytes = 0;
-};
\ No newline at end of file
+    uint16_t cipher_id = 0;
+};
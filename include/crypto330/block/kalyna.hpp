@@ -24,15 +24,13 @@ private:
 
     void DecryptBlock(uint8_t *block) const override;
 
-    void AddRoundKeyExpand(uint8_t *block, const uint8_t *round_key) const;
-
-    void XorRoundKeyExpand(uint8_t *block, const uint8_t *round_key) const;
+    void EncryptBlocks(uint8_t *blocks, size_t n) const override;
 
-    void AddRoundKey(uint8_t *block, uint64_t round) const;
+    void DecryptBlocks(uint8_t *blocks, size_t n) const override;
 
-    void XorRoundKey(uint8_t *block, uint64_t round) const;
+    void AddRoundKeyExpand(uint8_t *block, const uint8_t *round_key) const;
 
-    void SubRoundKey(uint8_t *block, uint64_t round) const;
+    void XorRoundKeyExpand(uint8_t *block, const uint8_t *round_key) const;
 
     void EncryptRound(uint8_t *block) const;
 
@@ -48,12 +46,6 @@ private:
 
     void MixColumns(uint8_t *block) const;
 
-    void DecryptRound(uint8_t *block) const;
-
-    void InvSubBytes(uint8_t *block) const;
-
-    void InvShiftRows(uint8_t *block) const;
-
     void InvMixColumns(uint8_t *block) const;
 
 
@@ -63,6 +55,13 @@ private:
     uint64_t key_words;
     uint64_t block_words;
 
+    // Entry points of the KalynaImpl specialization for this type, selected once in the constructor
+    using BlocksFunction = void (*)(const uint64_t *round_keys, const uint64_t *inv_round_keys, uint8_t *blocks, size_t n);
+    BlocksFunction encrypt_blocks;
+    BlocksFunction decrypt_blocks;
+
     uint8_t key[64]{};
     uint8_t key_expansion[20][64]{};
+    // InvMixColumns of the inner round keys for the equivalent inverse cipher
+    uint64_t inv_key_expansion[20][8]{};
 };
@@ -1,13 +1,40 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <string>
 #include <vector>
 
 class Hash {
 public:
     Hash() = default;
 
-    virtual std::vector<uint8_t> GetHash(const std::vector<uint8_t>& data) const = 0;
+    virtual ~Hash() = default;
+
+    // One-shot hash of length bytes at data, whole blocks are read in place
+    virtual std::vector<uint8_t> GetHash(const uint8_t *data, size_t length) const = 0;
+
+    std::vector<uint8_t> GetHash(const std::vector<uint8_t>& data) const {
+        return GetHash(data.data(), data.size());
+    }
+
+    // Streaming interface: Update feeds the next piece of the message, Final returns the digest of
+    // everything fed since the last Reset / Final and starts a new message. The stream is per object,
+    // GetHash does not touch it.
+    virtual void Update(const uint8_t *data, size_t length) = 0;
+
+    virtual std::vector<uint8_t> Final() = 0;
+
+    virtual void Reset() = 0;
+
+    // Input block and digest sizes in bytes
+    virtual uint64_t GetBlockSize() const = 0;
+
+    virtual uint64_t GetDigestSize() const = 0;
 private:
 
-};
\ No newline at end of file
+};
+
+// Streams the file through hash in fixed-size reads, so memory does not grow with the file. Returns an
+// empty vector if the file cannot be read.
+std::vector<uint8_t> HashFile(Hash &hash, const std::string &path);
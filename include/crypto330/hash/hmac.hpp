@@ -0,0 +1,6 @@
+#pragma once
+
+#include "hash.hpp"
+
+// HMAC (RFC 2104) over any Hash
+std::vector<uint8_t> Hmac(const Hash &hash, const std::vector<uint8_t> &key, const std::vector<uint8_t> &message);
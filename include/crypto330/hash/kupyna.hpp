@@ -11,7 +11,19 @@ public:
 
     explicit Kupyna(Size size = Size::Kupyna256);
 
-    std::vector<uint8_t> GetHash(const std::vector<uint8_t> &data) const override;
+    using Hash::GetHash;
+
+    std::vector<uint8_t> GetHash(const uint8_t *data, size_t length) const override;
+
+    void Update(const uint8_t *data, size_t length) override;
+
+    std::vector<uint8_t> Final() override;
+
+    void Reset() override;
+
+    uint64_t GetBlockSize() const override;
+
+    uint64_t GetDigestSize() const override;
 
 private:
 
@@ -22,6 +34,12 @@ private:
 
     void ProcessBlock(uint8_t* block, bool p_or_q) const;
 
+    // state ^= T+(state ^ data) ^ T-(data) for one message block
+    void CompressBlock(uint8_t* state, const uint8_t* data) const;
+
+    // Pads the last rest bytes of a length-byte message and returns the digest
+    std::vector<uint8_t> Finish(uint8_t* state, const uint8_t* rest_data, size_t rest, uint64_t length) const;
+
     Size size;
 
     uint64_t block_size;
@@ -30,4 +48,10 @@ private:
 
     const uint64_t rows = 8;
     uint64_t columns;
+
+    // Streaming state, buffered holds the bytes of a block not yet compressed
+    uint8_t stream_state[8 * 16];
+    uint8_t stream_buffer[8 * 16];
+    size_t buffered;
+    uint64_t stream_length;
 };
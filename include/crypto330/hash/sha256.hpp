@@ -1,14 +1,88 @@
 #pragma once
 
 #include "hash.hpp"
+#include <cstddef>
 
 
 class Sha256 : public Hash {
 public:
-    Sha256() = default;
+    // Lane width of GetHashes: Portable hashes one message at a time, SSE2 4, AVX2 8 and AVX512 16
+    // messages at once. Auto picks the widest one the CPU supports.
+    enum class Engine {
+        Auto,
+        Portable,
+        SSE2,
+        AVX2,
+        AVX512
+    };
 
-    std::vector<uint8_t> GetHash(const std::vector<uint8_t> &data) const override;
+    // Compression function GetHash runs on one message: SHANI uses the SHA extensions, AVX2 computes the
+    // message schedule four words per vector and Scalar is the portable reference. Auto picks the fastest
+    // one the CPU supports.
+    enum class Compression {
+        Auto,
+        Scalar,
+        AVX2,
+        SHANI
+    };
+
+    explicit Sha256(Engine engine = Engine::Auto, Compression compression = Compression::Auto);
+
+    using Hash::GetHash;
+
+    std::vector<uint8_t> GetHash(const uint8_t *data, size_t length) const override;
+
+    void Update(const uint8_t *data, size_t length) override;
+
+    std::vector<uint8_t> Final() override;
+
+    void Reset() override;
+
+    // Hashes independent messages in SIMD lanes, a lane takes the next message as soon as its own is done
+    std::vector<std::vector<uint8_t>> GetHashes(const std::vector<std::vector<uint8_t>> &messages) const;
+
+    // Writes count 32-byte digests to digests
+    void GetHashes(const uint8_t *const *messages, const size_t *lengths, size_t count, uint8_t *digests) const;
+
+    uint64_t GetBlockSize() const override;
+
+    uint64_t GetDigestSize() const override;
+
+    Engine GetEngine() const;
+
+    Compression GetCompression() const;
 
 private:
-    void ProcessBlock(uint8_t *data, uint32_t hash[8]) const;
+    // Runs n consecutive blocks through the selected compression function
+    void ProcessBlocks(const uint8_t *data, size_t n, uint32_t hash[8]) const;
+
+    void ProcessBlock(const uint8_t *data, uint32_t hash[8]) const;
+
+    // Pads the last rest bytes of a length-byte message and returns the digest
+    std::vector<uint8_t> Finish(uint32_t hash[8], const uint8_t *rest_data, size_t rest, uint64_t length) const;
+
+    Engine engine;
+    Compression compression;
+
+    // Streaming state, buffered holds the bytes of a block not yet compressed
+    uint32_t stream_hash[8];
+    uint8_t stream_buffer[64];
+    size_t buffered;
+    uint64_t stream_length;
 };
+
+extern const uint32_t SHA256_K[64];
+
+// Multi-buffer kernels. state holds word i of lane k at state[i * lanes + k], data[k] points at n consecutive
+// blocks of lane k. Lanes whose bit is clear in active are masked: their data is not read and their state
+// is kept.
+void Sha256_BlocksSSE2(uint32_t *state, const uint8_t *const *data, size_t n, uint32_t active);
+
+void Sha256_BlocksAVX2(uint32_t *state, const uint8_t *const *data, size_t n, uint32_t active);
+
+void Sha256_BlocksAVX512(uint32_t *state, const uint8_t *const *data, size_t n, uint32_t active);
+
+// Single-message compression of n consecutive blocks into state[8]
+void Sha256_CompressAVX2(uint32_t *state, const uint8_t *data, size_t n);
+
+void Sha256_CompressSHANI(uint32_t *state, const uint8_t *data, size_t n);
@@ -92,6 +92,11 @@ public:
 
     static UHugeInt Rand(const UHugeInt &min, const UHugeInt &max, std::mt19937_64 &rng);
 
+    // Same as above with digits from the thread's SecureRandom
+    static UHugeInt Rand(const UHugeInt &max);
+
+    static UHugeInt Rand(const UHugeInt &min, const UHugeInt &max);
+
     static UHugeInt FromBytes(const std::vector<uint8_t> &bytes);
 
     static UHugeInt FromHex(const std::string & hex);
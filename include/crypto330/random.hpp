@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class BlockEncryption;
+
+// Fills bytes from the operating system (getrandom, /dev/urandom as a fallback). Slow, used for seeding.
+// Aborts if the system source cannot deliver every byte.
+void SystemRandomBytes(uint8_t *data, size_t bytes);
+
+// AES-256 CTR-DRBG seeded from the operating system. The key and counter are replaced with fresh output
+// after every refill, so earlier output cannot be recovered from the state, and the generator reseeds
+// from the system periodically and after fork(). Not thread-safe, use one instance per thread.
+// Satisfies UniformRandomBitGenerator.
+class SecureRandom {
+public:
+    using result_type = uint64_t;
+
+    SecureRandom();
+
+    ~SecureRandom();
+
+    void Fill(uint8_t *data, size_t bytes);
+
+    result_type operator()();
+
+    static constexpr result_type min() { return 0; }
+
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    // Mixes fresh system entropy into the key
+    void Reseed();
+
+private:
+    static const size_t POOL_BYTES = 1024;
+    static const uint64_t RESEED_BYTES = 1ull << 30u;
+
+    // Writes n keystream blocks and advances the counter
+    void Generate(uint8_t *blocks, size_t n);
+
+    void Rekey(const uint8_t *seed);
+
+    void Refill();
+
+    std::unique_ptr<BlockEncryption> aes;
+    uint8_t counter[16]{};
+    alignas(64) uint8_t pool[POOL_BYTES]{};
+    size_t pool_offset = POOL_BYTES;
+    uint64_t generated = 0;
+    uint64_t generation = 0;
+};
+
+// Cryptographically secure bytes from a per-thread SecureRandom
+void RandomBytes(uint8_t *data, size_t bytes);
+
+std::vector<uint8_t> RandomBytes(size_t bytes);
+
+SecureRandom &GetThreadRandom();
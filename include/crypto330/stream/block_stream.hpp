@@ -1,50 +1,164 @@
+#include <cstdint>
 #include <memory>
 #include "crypto330/block/block.hpp"
+#include "crypto330/hash/hash.hpp"
 
 class BlockStreamEncryption {
 public:
+    // CFB is full-block CFB-128 (segment of one block), CFB8 is CFB with 8-bit segments.
+    // GCM is authenticated encryption for 16-byte block ciphers. CTR_HMAC is encrypt-then-MAC with any cipher
+    // and the Hash given to the constructor.
     enum class Mode {
         ECB,
         CBC,
         CFB,
         OFB,
-        CTR
+        CTR,
+        CFB8,
+        GCM,
+        CTR_HMAC
+    };
+
+    static constexpr size_t GCM_IV_BYTES = 12;
+    static constexpr size_t GCM_TAG_BYTES = 16;
+
+    // Returned by the pointer Decrypt when a GCM or CTR_HMAC tag does not match or the input is too short to hold one
+    static constexpr size_t AUTHENTICATION_FAILED = SIZE_MAX;
+
+    // Incremental encryption or decryption of one message for any mode.
+    // Call Init once per message, Update for each chunk and Final at the end.
+    class Context {
+    public:
+        Context(const BlockStreamEncryption &stream, Mode mode, bool encryption);
+
+        // iv has the block size of the cipher, it is ignored by ECB
+        void Init(const uint8_t *iv);
+
+        // Processes length bytes and returns the number of bytes written to out. Stream modes (CFB, CFB8, OFB, CTR)
+        // write exactly length bytes, ECB and CBC keep a partial block until the next call, so out must have room
+        // for length + block size bytes. out may be the same buffer as in.
+        size_t Update(const uint8_t *in, uint8_t *out, size_t length);
+
+        // Zero-pads and writes a partial ECB/CBC block kept by Update, returns the number of bytes written
+        size_t Final(uint8_t *out);
+
+    private:
+        void ProcessBlocks(uint8_t *blocks, uint64_t n);
+
+        void ProcessCFB(uint8_t *data, uint64_t length);
+
+        void ProcessOFB(uint8_t *data, uint64_t length);
+
+        const BlockStreamEncryption *stream;
+        Mode mode;
+        bool encryption;
+        uint64_t block_size;
+        uint64_t segment_size;
+
+        // CBC chaining block, OFB output block or CTR initial counter block
+        uint8_t state[BlockEncryption::MAX_BLOCK_BYTES]{};
+        // ECB/CBC partial block, CFB keystream of the current segment
+        uint8_t buffer[BlockEncryption::MAX_BLOCK_BYTES]{};
+        uint64_t buffered = 0;
+        // CFB sliding shift register, see ProcessCFB
+        uint8_t window[2 * BlockEncryption::MAX_BLOCK_BYTES]{};
+        uint64_t window_position = 0;
+        // Bytes processed since Init
+        uint64_t position = 0;
     };
 
     BlockStreamEncryption(std::unique_ptr<BlockEncryption> && encryption);
 
-    void Decrypt(std::vector<uint8_t> &data, Mode mode) const;
+    // mac and mac_key are used by Mode::CTR_HMAC. Without them CTR_HMAC encryption writes nothing (the vector
+    // overload clears data) and decryption fails authentication.
+    BlockStreamEncryption(std::unique_ptr<BlockEncryption> && encryption, std::unique_ptr<Hash> && mac,
+                          const std::string & mac_key, bool hex = false);
+
+    // Returns false if authentication fails (GCM and CTR_HMAC), data is cleared then
+    bool Decrypt(std::vector<uint8_t> &data, Mode mode) const;
 
     void Encrypt(std::vector<uint8_t> &data, Mode mode) const;
 
+    // Out-of-place versions with the same output format, out may be the same buffer as in.
+    // Both return the number of bytes written. Encrypt needs GetEncryptedSize(length, mode) bytes of capacity,
+    // Decrypt needs length bytes, both return 0 without writing anything if capacity is smaller.
+    size_t Encrypt(const uint8_t *in, size_t length, uint8_t *out, size_t capacity, Mode mode) const;
+
+    size_t Decrypt(const uint8_t *in, size_t length, uint8_t *out, size_t capacity, Mode mode) const;
+
+    size_t GetEncryptedSize(size_t length, Mode mode) const;
+
+    // GCM with additional authenticated data, encryption and GHASH run over the same tiles in one pass.
+    // Encrypt and Decrypt with Mode::GCM store ciphertext || iv || tag and have no additional data.
+    void EncryptGCM(const uint8_t *iv, const uint8_t *aad, size_t aad_length, const uint8_t *in, uint8_t *out,
+                    size_t length, uint8_t *tag) const;
+
+    // Returns false and zeroes out if the tag does not match
+    bool DecryptGCM(const uint8_t *iv, const uint8_t *aad, size_t aad_length, const uint8_t *in, uint8_t *out,
+                    size_t length, const uint8_t *tag) const;
+
+    // Decrypts bytes [offset, offset + length) of data encrypted with Mode::CTR.
+    // The counter of the first block is computed directly, so the cost does not depend on the data size.
+    std::vector<uint8_t> DecryptRangeCTR(const std::vector<uint8_t> &data, uint64_t offset, uint64_t length) const;
+
+    // CTR files start with a BlockEncryption::FileHeader holding the IV, followed by exactly length bytes
+    BlockEncryption::FileStats EncryptFileCTR(const std::string &source, const std::string &destination) const;
+
+    BlockEncryption::FileStats DecryptFileCTR(const std::string &source, const std::string &destination) const;
+
+    // Reads and decrypts only bytes [offset, offset + length) of a file written by EncryptFileCTR
+    bool DecryptFileRangeCTR(const std::string &source, uint64_t offset, uint64_t length,
+                             std::vector<uint8_t> &result) const;
+
 private:
     std::unique_ptr<BlockEncryption> encryption;
+    std::unique_ptr<Hash> mac;
+    std::vector<uint8_t> mac_key;
+
+    // ECB: ciphertext || 64-bit plaintext length, CBC: iv || ciphertext || 64-bit plaintext length
+    size_t EncryptECB(const uint8_t *in, size_t length, uint8_t *out) const;
+
+    size_t DecryptECB(const uint8_t *in, size_t length, uint8_t *out) const;
+
+    size_t EncryptCBC(const uint8_t *in, size_t length, uint8_t *out) const;
 
-    void EncryptECB(std::vector<uint8_t> &data) const;
+    size_t DecryptCBC(const uint8_t *in, size_t length, uint8_t *out) const;
 
-    void DecryptECB(std::vector<uint8_t> &data) const;
+    // CFB, CFB8, OFB and CTR: the ciphertext has the plaintext length and is followed by the IV
+    size_t EncryptStream(const uint8_t *in, size_t length, uint8_t *out, Mode mode) const;
 
-    void EncryptCBC(std::vector<uint8_t> & data) const;
+    size_t DecryptStream(const uint8_t *in, size_t length, uint8_t *out, Mode mode) const;
 
-    void DecryptCBC(std::vector<uint8_t> & data) const;
+    // Writes the GCM tag of in (encryption) or out (decryption) to tag
+    void ProcessGCM(const uint8_t *iv, const uint8_t *aad, size_t aad_length, const uint8_t *in, uint8_t *out,
+                    size_t length, uint8_t *tag, bool encrypt) const;
 
-    void EncryptCFB(std::vector<uint8_t> & data) const;
+    // ciphertext || iv || tag. Tiles are encrypted and hashed on all threads while they are in cache,
+    // the tag is the HMAC of iv, the tile digests and the length.
+    size_t EncryptCTRHMAC(const uint8_t *in, size_t length, uint8_t *out) const;
 
-    void DecryptCFB(std::vector<uint8_t> & data) const;
+    size_t DecryptCTRHMAC(const uint8_t *in, size_t length, uint8_t *out) const;
 
-    void EncryptOFB(std::vector<uint8_t> & data) const;
+    // Writes the tag of ciphertext produced by (encrypt) or given to (decrypt) the CTR pass
+    void ProcessCTRHMAC(const uint8_t *iv, const uint8_t *in, uint8_t *out, size_t length, uint8_t *tag,
+                        bool encrypt) const;
 
-    void DecryptOFB(std::vector<uint8_t> & data) const;
+    // Decrypts n CBC blocks in place on all threads
+    void DecryptCBCBlocks(uint8_t *blocks, uint64_t n, const uint8_t *iv) const;
 
-    void EncryptCTR(std::vector<uint8_t> & data) const;
+    // Decrypts CFB segments in place on all threads, the last segment may be partial
+    void DecryptCFBSegments(uint8_t *data, uint64_t length, const uint8_t *iv, uint64_t segment_size) const;
 
-    void DecryptCTR(std::vector<uint8_t> & data) const;
+    // Writes counter blocks first .. first + n - 1 derived from iv
+    void FillCounters(uint8_t *blocks, const uint8_t *iv, uint64_t first, uint64_t n) const;
 
-    void PushUint64(std::vector<uint8_t> & data, uint64_t value) const;
+    // XORs the keystream starting at stream byte offset into data
+    void ApplyCTR(uint8_t *data, uint64_t length, const uint8_t *iv, uint64_t offset) const;
 
-    uint64_t PopUint64(std::vector<uint8_t> & data) const;
+    BlockEncryption::FileStats ProcessFileCTR(const std::string &source, const std::string &destination,
+                                              bool encrypt) const;
 
-    void AlignData(std::vector<uint8_t> & data, uint64_t block_size) const;
+    bool ReadHeaderCTR(const std::string &source, BlockEncryption::FileHeader &header) const;
 
-    std::vector<uint8_t> GenerateIV(uint64_t bytes) const;
+    void GenerateIV(uint8_t *iv, uint64_t bytes) const;
 };
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "keystream.hpp"
+#include <string>
+
+// ChaCha20 (RFC 8439). A 12-byte nonce leaves a 32-bit block counter, the original 8-byte nonce
+// leaves a 64-bit one.
+class ChaCha20 : public KeystreamCipher {
+public:
+    static const size_t KEY_BYTES = 32;
+    static const size_t NONCE_BYTES = 12;
+    static const size_t SHORT_NONCE_BYTES = 8;
+
+    // An empty nonce is 12 zero bytes
+    explicit ChaCha20(const std::string & key, bool hex = false, const std::vector<uint8_t> & nonce = {},
+                      Engine engine = Engine::Auto);
+
+protected:
+    ChaCha20(const std::vector<uint8_t> & key, const std::vector<uint8_t> & nonce, Engine engine);
+
+    void GenerateBlocks(uint64_t counter, uint8_t *blocks, size_t n, Engine engine) const override;
+
+private:
+    // Initial state with the counter words left zero
+    uint32_t state[16]{};
+    bool wide_counter = false;
+};
+
+// XChaCha20: HChaCha20 derives a subkey from the key and the first 16 nonce bytes, the last 8 bytes
+// are the nonce of ChaCha20 with a 64-bit counter. Random nonces are safe at this size.
+class XChaCha20 : public ChaCha20 {
+public:
+    static const size_t NONCE_BYTES = 24;
+
+    XChaCha20(const std::string & key, bool hex, const std::vector<uint8_t> & nonce, Engine engine = Engine::Auto);
+};
+
+// 32-byte subkey from a 32-byte key and a 16-byte nonce
+void HChaCha20(const uint8_t *key, const uint8_t *nonce, uint8_t *subkey);
+
+// Vector kernels, process the largest multiple of 4 (SSE2), 8 (AVX2) or 16 (AVX512) blocks of n
+// and return that count. wide_counter carries the counter into word 13.
+size_t ChaCha_BlocksSSE2(const uint32_t *state, uint64_t counter, bool wide_counter, uint8_t *blocks, size_t n);
+
+size_t ChaCha_BlocksAVX2(const uint32_t *state, uint64_t counter, bool wide_counter, uint8_t *blocks, size_t n);
+
+size_t ChaCha_BlocksAVX512(const uint32_t *state, uint64_t counter, bool wide_counter, uint8_t *blocks, size_t n);
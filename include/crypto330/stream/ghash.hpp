@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// GHASH universal hash of GCM keyed with H = E(K, 0^128).
+// Uses PCLMULQDQ when the CPU supports it and Shoup's 4-bit tables otherwise.
+class GHash {
+public:
+    explicit GHash(const uint8_t *h);
+
+    GHash(const uint8_t *h, bool clmul);
+
+    // Absorbs length bytes, a partial last block is zero-padded, so only the last call
+    // for the additional data and for the ciphertext may have a length that is not a multiple of 16
+    void Update(const uint8_t *data, size_t length);
+
+    // Absorbs the byte lengths of the additional data and the ciphertext and writes the 16-byte hash
+    void Final(uint64_t aad_length, uint64_t length, uint8_t *digest);
+
+private:
+    void UpdateTable(const uint8_t *blocks, size_t n);
+
+    void MultiplyTable(uint8_t *x) const;
+
+    bool clmul;
+    uint8_t y[16]{};
+
+    // H^1 .. H^4 byte-reversed for the carry-less multiply, four blocks are reduced at once
+    uint8_t powers[4][16]{};
+
+    // Products of H with every 4-bit value as big-endian 64-bit halves
+    uint64_t table_high[16]{};
+    uint64_t table_low[16]{};
+};
+
+void GHash_InitClmul(const uint8_t *h, uint8_t powers[4][16]);
+
+void GHash_UpdateClmul(uint8_t *y, const uint8_t powers[4][16], const uint8_t *blocks, size_t n);
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Base of the counter-based stream ciphers (Salsa20, ChaCha20). Every 64-byte keystream block depends
+// only on the key, nonce and block counter, so blocks are generated several at a time in vector lanes,
+// large buffers are split across OpenMP threads and any position can be reached without generating
+// what comes before it.
+class KeystreamCipher {
+public:
+    static const size_t BLOCK_BYTES = 64;
+
+    // Portable is plain C++, SSE2 generates 4 blocks, AVX2 8 blocks and AVX512 16 blocks at once.
+    // Auto picks the widest one the CPU supports. Engines are ordered by width.
+    enum class Engine {
+        Auto,
+        Portable,
+        SSE2,
+        AVX2,
+        AVX512
+    };
+
+    explicit KeystreamCipher(Engine engine);
+
+    virtual ~KeystreamCipher() = default;
+
+    void Encrypt(std::vector<uint8_t> &data) const;
+
+    void Decrypt(std::vector<uint8_t> &data) const;
+
+    // Out-of-place versions, out may be the same buffer as in
+    void Encrypt(const uint8_t *in, uint8_t *out, size_t length) const;
+
+    void Decrypt(const uint8_t *in, uint8_t *out, size_t length) const;
+
+    // Seek: starts at byte offset of the keystream, 64 * counter to start at block counter
+    void Encrypt(const uint8_t *in, uint8_t *out, size_t length, uint64_t offset) const;
+
+    void Decrypt(const uint8_t *in, uint8_t *out, size_t length, uint64_t offset) const;
+
+    // Writes n keystream blocks starting at block counter
+    void GenerateKeystream(uint64_t counter, uint8_t *blocks, size_t n) const;
+
+    Engine GetEngine() const;
+
+protected:
+    // Implementations fill n blocks with the given engine, n is any number of blocks
+    virtual void GenerateBlocks(uint64_t counter, uint8_t *blocks, size_t n, Engine engine) const = 0;
+
+private:
+    void ProcessData(const uint8_t *in, uint8_t *out, size_t length, uint64_t offset) const;
+
+    Engine engine;
+};
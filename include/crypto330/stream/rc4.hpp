@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -6,11 +8,47 @@ class RC4 {
 public:
     explicit RC4(const std::string & key);
 
+    // Every call starts at the beginning of the keystream
     void Decrypt(std::vector<uint8_t> &data) const;
 
     void Encrypt(std::vector<uint8_t> &data) const;
 
+    // Out-of-place versions, out may be the same buffer as in
+    void Encrypt(const uint8_t *in, uint8_t *out, size_t length) const;
+
+    void Decrypt(const uint8_t *in, uint8_t *out, size_t length) const;
+
+    // Keystream position of one message, consecutive Update calls continue where the last one stopped
+    class Stream {
+    public:
+        explicit Stream(const RC4 & cipher);
+
+        // Encryption and decryption are the same, out may be the same buffer as in
+        void Update(const uint8_t *in, uint8_t *out, size_t length);
+
+    private:
+        friend class RC4;
+
+        uint8_t s[256];
+        uint8_t i = 0;
+        uint8_t j = 0;
+    };
+
+    struct Job {
+        Stream *stream;
+        const uint8_t *in;
+        uint8_t *out;
+        size_t length;
+    };
+
+    // Updates independent streams BATCH_LANES at a time in one loop, so the dependent S-box loads and
+    // stores of different streams overlap. A lane that finishes takes the next job.
+    // Every stream may appear only once.
+    static void UpdateBatch(const Job *jobs, size_t count);
+
+    static const size_t BATCH_LANES = 4;
+
 private:
-    void ProcessData(std::vector<uint8_t> &data) const;
-    std::string key;
-};
\ No newline at end of file
+    // State after the key schedule, copied by every message
+    uint8_t initial_state[256];
+};
@@ -1,18 +1,30 @@
 #pragma once
 
-#include "crypto330/block/block.hpp"
+#include "keystream.hpp"
+#include <string>
 
-class Salsa {
+// Salsa20/20 with a 64-bit nonce and a 64-bit block counter
+class Salsa : public KeystreamCipher {
 public:
-    Salsa(const std::string & key);
+    static const size_t NONCE_BYTES = 8;
 
-    void Encrypt(std::vector<uint8_t> & data) const;
+    // 16- and 32-byte keys are standard, shorter keys are zero-padded to 32 bytes.
+    // An empty nonce is all zeros.
+    explicit Salsa(const std::string & key, bool hex = false, const std::vector<uint8_t> & nonce = {},
+                   Engine engine = Engine::Auto);
 
-    void Decrypt(std::vector<uint8_t> & data) const;
+protected:
+    void GenerateBlocks(uint64_t counter, uint8_t *blocks, size_t n, Engine engine) const override;
 
 private:
+    // Initial state with the counter words 8 and 9 left zero
+    uint32_t state[16]{};
+};
 
-    void ProcessData(std::vector<uint8_t> & data) const;
+// Vector kernels, process the largest multiple of 4 (SSE2), 8 (AVX2) or 16 (AVX512) blocks of n
+// and return that count
+size_t Salsa_BlocksSSE2(const uint32_t *state, uint64_t counter, uint8_t *blocks, size_t n);
 
-    uint32_t key[8];
-};
\ No newline at end of file
+size_t Salsa_BlocksAVX2(const uint32_t *state, uint64_t counter, uint8_t *blocks, size_t n);
+
+size_t Salsa_BlocksAVX512(const uint32_t *state, uint64_t counter, uint8_t *blocks, size_t n);
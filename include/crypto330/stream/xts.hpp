@@ -0,0 +1,30 @@
+#pragma once
+
+#include "crypto330/block/block.hpp"
+#include <memory>
+
+// XTS (IEEE 1619) for ciphers with 16-byte blocks. Every sector is encrypted independently
+// with a tweak derived from its number, so sectors can be read and written in any order.
+class XtsEncryption {
+public:
+    // encryption is keyed with the data key, tweak with the tweak key, both must be the same cipher
+    XtsEncryption(std::unique_ptr<BlockEncryption> && encryption, std::unique_ptr<BlockEncryption> && tweak);
+
+    // length must be a non-zero multiple of 16
+    void EncryptSector(uint8_t *data, size_t length, uint64_t sector) const;
+
+    void DecryptSector(uint8_t *data, size_t length, uint64_t sector) const;
+
+    // count consecutive sectors of sector_bytes starting at first_sector, processed on all threads
+    void EncryptSectors(uint8_t *data, size_t sector_bytes, uint64_t first_sector, size_t count) const;
+
+    void DecryptSectors(uint8_t *data, size_t sector_bytes, uint64_t first_sector, size_t count) const;
+
+private:
+    void ProcessSector(uint8_t *data, size_t length, uint64_t sector, bool encrypt) const;
+
+    void ProcessSectors(uint8_t *data, size_t sector_bytes, uint64_t first_sector, size_t count, bool encrypt) const;
+
+    std::unique_ptr<BlockEncryption> encryption;
+    std::unique_ptr<BlockEncryption> tweak;
+};
@@ -1,11 +1,68 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <string>
 #include <vector>
 
+#if defined(__x86_64__) || defined(__i386__)
+#define CRYPTO330_X86 1
+#endif
+
 uint8_t GF8_Mul(uint8_t a, uint8_t b, uint8_t poly);
 
 std::vector<uint8_t> HexStringToBytes(const std::string &str);
 
-std::vector<uint8_t> StringToBytes(const std::string &str);
\ No newline at end of file
+std::vector<uint8_t> StringToBytes(const std::string &str);
+
+// Instruction set extensions reported by CPUID, detected once on first use
+struct CpuFeatures {
+    bool aes = false;
+    bool ssse3 = false;
+    bool sse41 = false;
+    bool pclmul = false;
+    bool sse2 = false;
+    // AVX2 / AVX-512F instructions and OS support for the 256- and 512-bit registers
+    bool avx2 = false;
+    bool avx512f = false;
+    // SHA-1 / SHA-256 extensions
+    bool sha = false;
+};
+
+const CpuFeatures &GetCpuFeatures();
+
+inline uint32_t LoadBigEndian32(const uint8_t *bytes) {
+    return (uint32_t(bytes[0]) << 24u) | (uint32_t(bytes[1]) << 16u) | (uint32_t(bytes[2]) << 8u) | bytes[3];
+}
+
+inline void StoreBigEndian32(uint8_t *bytes, uint32_t value) {
+    bytes[0] = value >> 24u;
+    bytes[1] = value >> 16u;
+    bytes[2] = value >> 8u;
+    bytes[3] = value;
+}
+
+inline uint64_t LoadBigEndian64(const uint8_t *bytes) {
+    return (uint64_t(LoadBigEndian32(bytes)) << 32u) | LoadBigEndian32(bytes + 4);
+}
+
+inline void StoreBigEndian64(uint8_t *bytes, uint64_t value) {
+    StoreBigEndian32(bytes, value >> 32u);
+    StoreBigEndian32(bytes + 4, value);
+}
+
+// destination ^= source, a word at a time so the compiler can vectorize it
+inline void XorBytes(uint8_t *destination, const uint8_t *source, size_t bytes) {
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= bytes; i += sizeof(uint64_t)) {
+        uint64_t a, b;
+        std::memcpy(&a, destination + i, sizeof(uint64_t));
+        std::memcpy(&b, source + i, sizeof(uint64_t));
+        a ^= b;
+        std::memcpy(destination + i, &a, sizeof(uint64_t));
+    }
+    for (; i < bytes; i++) {
+        destination[i] ^= source[i];
+    }
+}
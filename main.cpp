@@ -1,23 +1,268 @@
 #include <iostream>
-#include <fstream>
+#include <iomanip>
 #include <chrono>
+#include <functional>
 
 #include <crypto330/block/aes.hpp>
-#include <crypto330/utils.hpp>
 #include <crypto330/block/kalyna.hpp>
+#include <crypto330/stream/block_stream.hpp>
+#include <crypto330/stream/ghash.hpp>
+#include <crypto330/stream/xts.hpp>
+#include <crypto330/stream/salsa.hpp>
+#include <crypto330/stream/chacha.hpp>
+#include <crypto330/stream/rc4.hpp>
+#include <crypto330/hash/sha256.hpp>
+#include <crypto330/utils.hpp>
+#include <crypto330/random.hpp>
+
+// Throughput benchmarks, build in Release and run the `runnable` target
+
+const size_t BENCHMARK_BYTES = 64 * 1024 * 1024;
+
+double MeasureSeconds(const std::function<void()> &function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Report(const std::string &name, size_t bytes, double seconds) {
+    std::cout << std::left << std::setw(32) << name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(9) << seconds << " s" << std::setw(10) << std::setprecision(1)
+              << bytes / seconds / (1024 * 1024) << " MB/s" << std::endl;
+}
+
+void BenchmarkAES() {
+    std::vector<uint8_t> data(BENCHMARK_BYTES);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = i * 31 + 7;
+    }
+    std::vector<std::pair<std::string, AES::Engine>> engines = {
+            {"Reference", AES::Engine::Reference},
+            {"TTable", AES::Engine::TTable},
+            {"Bitsliced", AES::Engine::Bitsliced},
+    };
+    if (GetCpuFeatures().aes) {
+        engines.emplace_back("AESNI", AES::Engine::AESNI);
+    }
+    for (auto &[name, engine] : engines) {
+        AES aes(AES::Type::AES128, "000102030405060708090A0B0C0D0E0F", true, engine);
+        const BlockEncryption &cipher = aes;
+        size_t blocks = data.size() / 16;
+        Report("AES128 " + name + " EncryptBlock", data.size(), MeasureSeconds([&] {
+            for (size_t i = 0; i < blocks; i++) {
+                cipher.EncryptBlock(data.data() + i * 16);
+            }
+        }));
+        Report("AES128 " + name + " EncryptBlocks", data.size(), MeasureSeconds([&] {
+            cipher.EncryptBlocks(data.data(), blocks);
+        }));
+        Report("AES128 " + name + " DecryptBlocks", data.size(), MeasureSeconds([&] {
+            cipher.DecryptBlocks(data.data(), blocks);
+        }));
+    }
+}
+
+void BenchmarkKalyna() {
+    std::vector<uint8_t> data(BENCHMARK_BYTES / 4);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = i * 31 + 7;
+    }
+    std::string key = "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+                      "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F";
+    std::vector<std::pair<std::string, Kalyna::Type>> types = {
+            {"128/128", Kalyna::Type::K128_128},
+            {"256/128", Kalyna::Type::K256_128},
+            {"256/256", Kalyna::Type::K256_256},
+            {"512/256", Kalyna::Type::K512_256},
+            {"512/512", Kalyna::Type::K512_512},
+    };
+    for (auto &[name, type] : types) {
+        Kalyna kalyna(type, key, true);
+        const BlockEncryption &cipher = kalyna;
+        size_t blocks = data.size() / cipher.GetBlockBytes();
+        Report("Kalyna " + name + " EncryptBlocks", data.size(), MeasureSeconds([&] {
+            cipher.EncryptBlocks(data.data(), blocks);
+        }));
+        Report("Kalyna " + name + " DecryptBlocks", data.size(), MeasureSeconds([&] {
+            cipher.DecryptBlocks(data.data(), blocks);
+        }));
+    }
+}
+
+void BenchmarkModes() {
+    std::vector<uint8_t> data(BENCHMARK_BYTES);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = i * 31 + 7;
+    }
+    std::vector<std::pair<std::string, BlockStreamEncryption::Mode>> modes = {
+            {"CBC", BlockStreamEncryption::Mode::CBC},
+            {"CFB", BlockStreamEncryption::Mode::CFB},
+            {"CFB8", BlockStreamEncryption::Mode::CFB8},
+            {"OFB", BlockStreamEncryption::Mode::OFB},
+            {"CTR", BlockStreamEncryption::Mode::CTR},
+            {"GCM", BlockStreamEncryption::Mode::GCM},
+            {"CTR_HMAC", BlockStreamEncryption::Mode::CTR_HMAC},
+    };
+    BlockStreamEncryption enc(std::make_unique<AES>(AES::Type::AES128, "000102030405060708090A0B0C0D0E0F", true),
+                              std::make_unique<Sha256>(), "benchmark mac key");
+    for (auto &[name, mode] : modes) {
+        Report("AES128 " + name + " Encrypt", data.size(), MeasureSeconds([&] {
+            enc.Encrypt(data, mode);
+        }));
+        Report("AES128 " + name + " Decrypt", data.size(), MeasureSeconds([&] {
+            enc.Decrypt(data, mode);
+        }));
+    }
+}
+
+void BenchmarkGHash() {
+    std::vector<uint8_t> data(BENCHMARK_BYTES / 4);
+    uint8_t h[16] = {0x66, 0xe9, 0x4b, 0xd4, 0xef, 0x8a, 0x2c, 0x3b};
+    uint8_t digest[16];
+    std::vector<std::pair<std::string, bool>> engines = {{"Table", false}};
+    if (GetCpuFeatures().pclmul) {
+        engines.emplace_back("PCLMUL", true);
+    }
+    for (auto &[name, clmul] : engines) {
+        GHash ghash(h, clmul);
+        Report("GHASH " + name, data.size(), MeasureSeconds([&] {
+            ghash.Update(data.data(), data.size());
+            ghash.Final(0, data.size(), digest);
+        }));
+    }
+}
+
+void BenchmarkXTS() {
+    const size_t SECTOR_BYTES = 4096;
+    std::vector<uint8_t> data(BENCHMARK_BYTES);
+    XtsEncryption xts(std::make_unique<AES>(AES::Type::AES128, "000102030405060708090A0B0C0D0E0F", true),
+                      std::make_unique<AES>(AES::Type::AES128, "0F0E0D0C0B0A09080706050403020100", true));
+    size_t sectors = data.size() / SECTOR_BYTES;
+    Report("AES128 XTS EncryptSectors", data.size(), MeasureSeconds([&] {
+        xts.EncryptSectors(data.data(), SECTOR_BYTES, 0, sectors);
+    }));
+    Report("AES128 XTS DecryptSectors", data.size(), MeasureSeconds([&] {
+        xts.DecryptSectors(data.data(), SECTOR_BYTES, 0, sectors);
+    }));
+}
+
+void BenchmarkStreamCiphers() {
+    std::vector<uint8_t> data(BENCHMARK_BYTES);
+    std::string key = "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F";
+    std::vector<std::pair<std::string, KeystreamCipher::Engine>> engines = {
+            {"Portable", KeystreamCipher::Engine::Portable}};
+    if (GetCpuFeatures().sse2) {
+        engines.emplace_back("SSE2", KeystreamCipher::Engine::SSE2);
+    }
+    if (GetCpuFeatures().avx2) {
+        engines.emplace_back("AVX2", KeystreamCipher::Engine::AVX2);
+    }
+    if (GetCpuFeatures().avx512f) {
+        engines.emplace_back("AVX512", KeystreamCipher::Engine::AVX512);
+    }
+    for (auto &[name, engine] : engines) {
+        Salsa salsa(key, true, {}, engine);
+        Report("Salsa20 " + name, data.size(), MeasureSeconds([&] {
+            salsa.Encrypt(data);
+        }));
+        ChaCha20 chacha(key, true, {}, engine);
+        Report("ChaCha20 " + name, data.size(), MeasureSeconds([&] {
+            chacha.Encrypt(data);
+        }));
+    }
+    XChaCha20 xchacha(key, true, std::vector<uint8_t>(XChaCha20::NONCE_BYTES, 7));
+    Report("XChaCha20", data.size(), MeasureSeconds([&] {
+        xchacha.Encrypt(data);
+    }));
+    RC4 rc4("Benchmark RC4 key");
+    Report("RC4", data.size(), MeasureSeconds([&] {
+        rc4.Encrypt(data);
+    }));
+}
+
+void BenchmarkRC4Messages() {
+    // Many short messages under one key, each from the start of the keystream
+    const size_t MESSAGE_BYTES = 256;
+    std::vector<uint8_t> data(BENCHMARK_BYTES / 4);
+    size_t messages = data.size() / MESSAGE_BYTES;
+    RC4 rc4("Benchmark RC4 key");
+    Report("RC4 256-byte messages", data.size(), MeasureSeconds([&] {
+        for (size_t i = 0; i < messages; i++) {
+            rc4.Encrypt(data.data() + i * MESSAGE_BYTES, data.data() + i * MESSAGE_BYTES, MESSAGE_BYTES);
+        }
+    }));
+    std::vector<RC4::Stream> streams(messages, RC4::Stream(rc4));
+    std::vector<RC4::Job> jobs;
+    for (size_t i = 0; i < messages; i++) {
+        jobs.push_back({&streams[i], data.data() + i * MESSAGE_BYTES, data.data() + i * MESSAGE_BYTES, MESSAGE_BYTES});
+    }
+    Report("RC4 256-byte messages batch", data.size(), MeasureSeconds([&] {
+        RC4::UpdateBatch(jobs.data(), jobs.size());
+    }));
+}
+
+void BenchmarkSha256() {
+    std::vector<std::pair<std::string, Sha256::Engine>> engines = {{"Portable", Sha256::Engine::Portable}};
+    if (GetCpuFeatures().sse2) {
+        engines.emplace_back("SSE2", Sha256::Engine::SSE2);
+    }
+    if (GetCpuFeatures().avx2) {
+        engines.emplace_back("AVX2", Sha256::Engine::AVX2);
+    }
+    if (GetCpuFeatures().avx512f) {
+        engines.emplace_back("AVX512", Sha256::Engine::AVX512);
+    }
+    std::vector<std::pair<std::string, Sha256::Compression>> compressions = {{"Scalar", Sha256::Compression::Scalar}};
+    if (GetCpuFeatures().avx2) {
+        compressions.emplace_back("AVX2", Sha256::Compression::AVX2);
+    }
+    if (GetCpuFeatures().sha && GetCpuFeatures().ssse3 && GetCpuFeatures().sse41) {
+        compressions.emplace_back("SHA-NI", Sha256::Compression::SHANI);
+    }
+    std::vector<std::pair<std::string, size_t>> sizes = {{"64B", 64}, {"1KB", 1024}, {"64KB", 64 * 1024}};
+    for (auto &[size, message_bytes] : sizes) {
+        std::vector<std::vector<uint8_t>> messages(BENCHMARK_BYTES / 8 / message_bytes,
+                                                   std::vector<uint8_t>(message_bytes, 0x5a));
+        size_t total = messages.size() * message_bytes;
+        for (auto &[name, compression] : compressions) {
+            Sha256 hash(Sha256::Engine::Portable, compression);
+            Report("SHA-256 " + size + " GetHash " + name, total, MeasureSeconds([&] {
+                for (auto &message : messages) {
+                    hash.GetHash(message);
+                }
+            }));
+        }
+        for (auto &[name, engine] : engines) {
+            Sha256 hash(engine);
+            Report("SHA-256 " + size + " " + name, total, MeasureSeconds([&] {
+                hash.GetHashes(messages);
+            }));
+        }
+    }
+}
 
-uint8_t get_char_byte(char c) {
-    uint8_t res;
-    *((char*)&res) = c;
-    return res;
+void BenchmarkRandom() {
+    std::vector<uint8_t> data(BENCHMARK_BYTES / 4);
+    Report("SecureRandom bulk", data.size(), MeasureSeconds([&] {
+        RandomBytes(data.data(), data.size());
+    }));
+    // IV-sized requests served from the pool
+    Report("SecureRandom 16-byte", data.size(), MeasureSeconds([&] {
+        for (size_t offset = 0; offset < data.size(); offset += 16) {
+            RandomBytes(data.data() + offset, 16);
+        }
+    }));
 }
 
 int main() {
-    char x = -1;
-    uint8_t y = x;
-    std::cout << std::hex << (int)(get_char_byte(x)) << std::endl;
-    std::cout << std::hex << (int)(y) << std::endl;
-    std::cout << std::hex << (int)(get_char_byte(x >> 1)) << std::endl;
-    std::cout << std::hex << (int)(y >> 1) << std::endl;
+    BenchmarkAES();
+    BenchmarkKalyna();
+    BenchmarkModes();
+    BenchmarkGHash();
+    BenchmarkXTS();
+    BenchmarkStreamCiphers();
+    BenchmarkRC4Messages();
+    BenchmarkSha256();
+    BenchmarkRandom();
     return 0;
 }
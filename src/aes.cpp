@@ -34,7 +34,7 @@ const uint8_t AES_R_CON[11][4] = {
         {0x36, 0x00, 0x00, 0x00},
 };
 
-const uint8_t AES_S_BOX[256] = {
+constexpr uint8_t AES_S_BOX[256] = {
         0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
         0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
         0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
@@ -53,7 +53,7 @@ const uint8_t AES_S_BOX[256] = {
         0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
 };
 
-const uint8_t AES_S_BOX_INV[256] = {
+constexpr uint8_t AES_S_BOX_INV[256] = {
         0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
         0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87, 0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
         0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d, 0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
@@ -72,6 +72,48 @@ const uint8_t AES_S_BOX_INV[256] = {
         0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d,
 };
 
+constexpr uint8_t AES_XTime(uint8_t x) {
+    return static_cast<uint8_t>((x << 1u) ^ ((x >> 7u) * 0x1bu));
+}
+
+constexpr uint8_t AES_Mul(uint8_t a, uint8_t b) {
+    uint8_t res = 0;
+    for (; b; b >>= 1u) {
+        if (b & 1u) {
+            res ^= a;
+        }
+        a = AES_XTime(a);
+    }
+    return res;
+}
+
+constexpr uint32_t AES_Word(uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3) {
+    return (uint32_t(b0) << 24u) | (uint32_t(b1) << 16u) | (uint32_t(b2) << 8u) | b3;
+}
+
+struct AES_Tables {
+    // te[i][x] is the MixColumns column of S(x) placed in row i, td[i][x] the same for InvMixColumns and S^-1(x)
+    uint32_t te[4][256];
+    uint32_t td[4][256];
+};
+
+constexpr AES_Tables AES_BuildTables() {
+    AES_Tables tables{};
+    for (uint32_t x = 0; x < 256; x++) {
+        uint8_t s = AES_S_BOX[x];
+        uint8_t si = AES_S_BOX_INV[x];
+        tables.te[0][x] = AES_Word(AES_Mul(s, 0x02), s, s, AES_Mul(s, 0x03));
+        tables.td[0][x] = AES_Word(AES_Mul(si, 0x0e), AES_Mul(si, 0x09), AES_Mul(si, 0x0d), AES_Mul(si, 0x0b));
+        for (uint32_t i = 1; i < 4; i++) {
+            tables.te[i][x] = (tables.te[i - 1][x] >> 8u) | (tables.te[i - 1][x] << 24u);
+            tables.td[i][x] = (tables.td[i - 1][x] >> 8u) | (tables.td[i - 1][x] << 24u);
+        }
+    }
+    return tables;
+}
+
+constexpr AES_Tables AES_T_TABLES = AES_BuildTables();
+
 void AES::BuildKeyExpansion() {
     std::copy(key, key + key_words * 4, key_expansion[0]);
     for (int column = key_words; column < 4 * (rounds + 1); column++) {
@@ -81,6 +123,11 @@ void AES::BuildKeyExpansion() {
                                              key_expansion[column - key_words][row] ^
                                              AES_R_CON[column / key_words][row];
             }
+        } else if (key_words > 6 && column % key_words == 4) {
+            for (uint32_t row = 0; row < 4; row++) {
+                key_expansion[column][row] = AES_S_BOX[key_expansion[column - 1][row]] ^
+                                             key_expansion[column - key_words][row];
+            }
         } else {
             for (uint32_t row = 0; row < 4; row++) {
                 key_expansion[column][row] = key_expansion[column - 1][row] ^
@@ -90,6 +137,26 @@ void AES::BuildKeyExpansion() {
     }
 }
 
+void AES::BuildWordKeyExpansion() {
+    const auto &td = AES_T_TABLES.td;
+    for (uint32_t column = 0; column < 4 * (rounds + 1); column++) {
+        encrypt_key_words[column] = LoadBigEndian32(key_expansion[column]);
+    }
+    // Equivalent inverse cipher: reversed round order, InvMixColumns applied to the inner round keys
+    for (uint32_t round = 0; round <= rounds; round++) {
+        for (uint32_t column = 0; column < 4; column++) {
+            uint32_t word = encrypt_key_words[(rounds - round) * 4 + column];
+            if (round != 0 && round != rounds) {
+                word = td[0][AES_S_BOX[word >> 24u]] ^
+                       td[1][AES_S_BOX[(word >> 16u) & 0xffu]] ^
+                       td[2][AES_S_BOX[(word >> 8u) & 0xffu]] ^
+                       td[3][AES_S_BOX[word & 0xffu]];
+            }
+            decrypt_key_words[round * 4 + column] = word;
+        }
+    }
+}
+
 void AES::AddRoundKey(uint8_t *block, uint32_t round) const {
     for (uint32_t i = 0; i < 16; i++) {
         *(block + i) ^= *(key_expansion[0] + round * 16 + i);
@@ -155,7 +222,7 @@ void AES::InvMixColumns(uint8_t *block) const {
     }
 }
 
-void AES::EncryptBlock(uint8_t *block) const {
+void AES::EncryptBlockReference(uint8_t *block) const {
     AddRoundKey(block, 0);
     for (uint32_t round = 1; round < rounds; round++) {
         SubBytes(block);
@@ -168,7 +235,7 @@ void AES::EncryptBlock(uint8_t *block) const {
     AddRoundKey(block, rounds);
 }
 
-void AES::DecryptBlock(uint8_t *block) const {
+void AES::DecryptBlockReference(uint8_t *block) const {
     AddRoundKey(block, rounds);
     InvShiftRows(block);
     InvSubBytes(block);
@@ -181,8 +248,158 @@ void AES::DecryptBlock(uint8_t *block) const {
     AddRoundKey(block, 0);
 }
 
-AES::AES(AES::Type type, const std::string &key_str, bool hex) {
-    GF8_InitLookup();
+// Runs Lanes independent blocks through the T-table rounds in lockstep, so the table lookups of
+// different blocks overlap instead of waiting on one dependency chain
+template<uint32_t Lanes, bool Encryption>
+void AES_ProcessTTable(uint8_t *blocks, const uint32_t *rk, uint32_t rounds) {
+    const auto &tables = Encryption ? AES_T_TABLES.te : AES_T_TABLES.td;
+    const uint8_t *sbox = Encryption ? AES_S_BOX : AES_S_BOX_INV;
+    // ShiftRows takes row r from column c + r, InvShiftRows from column c - r
+    constexpr uint32_t row1 = Encryption ? 1 : 3;
+    constexpr uint32_t row3 = Encryption ? 3 : 1;
+
+    uint32_t s[Lanes][4];
+    uint32_t t[Lanes][4];
+    for (uint32_t lane = 0; lane < Lanes; lane++) {
+        for (uint32_t c = 0; c < 4; c++) {
+            s[lane][c] = LoadBigEndian32(blocks + lane * 16 + c * 4) ^ rk[c];
+        }
+    }
+    for (uint32_t round = 1; round < rounds; round++) {
+        rk += 4;
+        for (uint32_t lane = 0; lane < Lanes; lane++) {
+            for (uint32_t c = 0; c < 4; c++) {
+                t[lane][c] = tables[0][s[lane][c] >> 24u] ^
+                             tables[1][(s[lane][(c + row1) & 3u] >> 16u) & 0xffu] ^
+                             tables[2][(s[lane][(c + 2) & 3u] >> 8u) & 0xffu] ^
+                             tables[3][s[lane][(c + row3) & 3u] & 0xffu] ^ rk[c];
+            }
+        }
+        memcpy(s, t, sizeof(s));
+    }
+    rk += 4;
+    for (uint32_t lane = 0; lane < Lanes; lane++) {
+        for (uint32_t c = 0; c < 4; c++) {
+            uint32_t word = AES_Word(sbox[s[lane][c] >> 24u],
+                                     sbox[(s[lane][(c + row1) & 3u] >> 16u) & 0xffu],
+                                     sbox[(s[lane][(c + 2) & 3u] >> 8u) & 0xffu],
+                                     sbox[s[lane][(c + row3) & 3u] & 0xffu]);
+            StoreBigEndian32(blocks + lane * 16 + c * 4, word ^ rk[c]);
+        }
+    }
+}
+
+void AES::EncryptBlockTTable(uint8_t *block) const {
+    AES_ProcessTTable<1, true>(block, encrypt_key_words, rounds);
+}
+
+void AES::DecryptBlockTTable(uint8_t *block) const {
+    AES_ProcessTTable<1, false>(block, decrypt_key_words, rounds);
+}
+
+void AES::EncryptBlocksTTable(uint8_t *blocks, size_t n) const {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        AES_ProcessTTable<4, true>(blocks + i * 16, encrypt_key_words, rounds);
+    }
+    for (; i < n; i++) {
+        AES_ProcessTTable<1, true>(blocks + i * 16, encrypt_key_words, rounds);
+    }
+}
+
+void AES::DecryptBlocksTTable(uint8_t *blocks, size_t n) const {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        AES_ProcessTTable<4, false>(blocks + i * 16, decrypt_key_words, rounds);
+    }
+    for (; i < n; i++) {
+        AES_ProcessTTable<1, false>(blocks + i * 16, decrypt_key_words, rounds);
+    }
+}
+
+void AES::EncryptBlock(uint8_t *block) const {
+    switch (engine) {
+        case Engine::Reference:
+            EncryptBlockReference(block);
+            break;
+        case Engine::AESNI:
+            EncryptBlockAesNi(block);
+            break;
+        case Engine::Bitsliced:
+            EncryptBlocksBitsliced(block, 1);
+            break;
+        default:
+            EncryptBlockTTable(block);
+            break;
+    }
+}
+
+void AES::DecryptBlock(uint8_t *block) const {
+    switch (engine) {
+        case Engine::Reference:
+            DecryptBlockReference(block);
+            break;
+        case Engine::AESNI:
+            DecryptBlockAesNi(block);
+            break;
+        case Engine::Bitsliced:
+            DecryptBlocksBitsliced(block, 1);
+            break;
+        default:
+            DecryptBlockTTable(block);
+            break;
+    }
+}
+
+void AES::EncryptBlocks(uint8_t *blocks, size_t n) const {
+    switch (engine) {
+        case Engine::Reference:
+            BlockEncryption::EncryptBlocks(blocks, n);
+            break;
+        case Engine::AESNI:
+            EncryptBlocksAesNi(blocks, n);
+            break;
+        case Engine::Bitsliced:
+            EncryptBlocksBitsliced(blocks, n);
+            break;
+        default:
+            EncryptBlocksTTable(blocks, n);
+            break;
+    }
+}
+
+void AES::DecryptBlocks(uint8_t *blocks, size_t n) const {
+    switch (engine) {
+        case Engine::Reference:
+            BlockEncryption::DecryptBlocks(blocks, n);
+            break;
+        case Engine::AESNI:
+            DecryptBlocksAesNi(blocks, n);
+            break;
+        case Engine::Bitsliced:
+            DecryptBlocksBitsliced(blocks, n);
+            break;
+        default:
+            DecryptBlocksTTable(blocks, n);
+            break;
+    }
+}
+
+AES::Engine AES::GetEngine() const {
+    return engine;
+}
+
+AES::AES(AES::Type type, const std::string &key_str, bool hex, Engine engine) : engine(engine) {
+    if (this->engine == Engine::Auto) {
+        this->engine = GetCpuFeatures().aes ? Engine::AESNI : Engine::TTable;
+    }
+    assert(this->engine != Engine::AESNI || GetCpuFeatures().aes);
+#ifdef CRYPTO330_X86
+    assert(this->engine != Engine::Bitsliced || GetCpuFeatures().ssse3);
+#endif
+    if (this->engine == Engine::Reference) {
+        GF8_InitLookup();
+    }
     switch (type) {
         case Type::AES128:
             key_words = 4;
@@ -195,15 +412,23 @@ AES::AES(AES::Type type, const std::string &key_str, bool hex) {
             break;
     }
     block_bytes = 16;
+    cipher_id = 0x0100 | static_cast<uint16_t>(type);
     rounds = 6 + key_words;
     std::vector<uint8_t> key_bytes;
     if (hex) {
-        assert(key_str.size() <= 32);
+        assert(key_str.size() <= key_words * 8);
         key_bytes = HexStringToBytes(key_str);
     } else {
-        assert(key_str.size() <= 16);
+        assert(key_str.size() <= key_words * 4);
         key_bytes = StringToBytes(key_str);
     }
     std::copy(key_bytes.begin(), key_bytes.end(), key);
     BuildKeyExpansion();
+    BuildWordKeyExpansion();
+    if (this->engine == Engine::AESNI) {
+        BuildAesNiKeyExpansion();
+    }
+    if (this->engine == Engine::Bitsliced) {
+        BuildBitslicedKeyExpansion();
+    }
 }
@@ -0,0 +1,346 @@
+#include <crypto330/block/aes.hpp>
+#include <crypto330/utils.hpp>
+#include <cstring>
+
+#ifdef CRYPTO330_X86
+// Plane shuffles compile to a single PSHUFB
+#pragma GCC target("ssse3")
+#endif
+
+// Constant-time AES over 8 blocks at once. The state is kept as 8 bit planes: byte i of plane b
+// holds bit b of byte i of each of the 8 blocks (bit k belongs to block k). SubBytes becomes a
+// boolean circuit over the planes, ShiftRows and MixColumns become byte shuffles inside a plane,
+// so no memory access depends on key or data.
+
+typedef uint8_t AES_Plane __attribute__((vector_size(16)));
+
+const uint32_t AES_BITSLICED_LANES = 8;
+
+inline AES_Plane AES_Shuffle(AES_Plane plane, AES_Plane mask) {
+    return __builtin_shuffle(plane, mask);
+}
+
+// Byte permutations of the column-major 4x4 state, index i = 4 * column + row
+const AES_Plane AES_SHIFT_ROWS = {0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12, 1, 6, 11};
+const AES_Plane AES_INV_SHIFT_ROWS = {0, 13, 10, 7, 4, 1, 14, 11, 8, 5, 2, 15, 12, 9, 6, 3};
+const AES_Plane AES_ROTATE_COLUMN_1 = {1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12};
+const AES_Plane AES_ROTATE_COLUMN_2 = {2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13};
+const AES_Plane AES_ROTATE_COLUMN_3 = {3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14};
+
+inline void AES_SwapMove(AES_Plane &a, AES_Plane &b, uint8_t mask, uint8_t shift) {
+    AES_Plane t = ((a >> shift) ^ b) & mask;
+    b ^= t;
+    a ^= t << shift;
+}
+
+// 8x8 bit transpose between the plane index and the bit index inside every byte; it is an involution,
+// so the same network packs blocks into planes and unpacks them back
+inline void AES_Transpose(AES_Plane *q) {
+    AES_SwapMove(q[0], q[1], 0x55, 1);
+    AES_SwapMove(q[2], q[3], 0x55, 1);
+    AES_SwapMove(q[4], q[5], 0x55, 1);
+    AES_SwapMove(q[6], q[7], 0x55, 1);
+
+    AES_SwapMove(q[0], q[2], 0x33, 2);
+    AES_SwapMove(q[1], q[3], 0x33, 2);
+    AES_SwapMove(q[4], q[6], 0x33, 2);
+    AES_SwapMove(q[5], q[7], 0x33, 2);
+
+    AES_SwapMove(q[0], q[4], 0x0f, 4);
+    AES_SwapMove(q[1], q[5], 0x0f, 4);
+    AES_SwapMove(q[2], q[6], 0x0f, 4);
+    AES_SwapMove(q[3], q[7], 0x0f, 4);
+}
+
+// Boyar-Peralta S-box circuit (113 gates), q[0] is the least significant bit plane
+inline void AES_BitslicedSubBytes(AES_Plane *q) {
+    AES_Plane x0 = q[7], x1 = q[6], x2 = q[5], x3 = q[4], x4 = q[3], x5 = q[2], x6 = q[1], x7 = q[0];
+
+    // Top linear transformation
+    AES_Plane y14 = x3 ^ x5;
+    AES_Plane y13 = x0 ^ x6;
+    AES_Plane y9 = x0 ^ x3;
+    AES_Plane y8 = x0 ^ x5;
+    AES_Plane t0 = x1 ^ x2;
+    AES_Plane y1 = t0 ^ x7;
+    AES_Plane y4 = y1 ^ x3;
+    AES_Plane y12 = y13 ^ y14;
+    AES_Plane y2 = y1 ^ x0;
+    AES_Plane y5 = y1 ^ x6;
+    AES_Plane y3 = y5 ^ y8;
+    AES_Plane t1 = x4 ^ y12;
+    AES_Plane y15 = t1 ^ x5;
+    AES_Plane y20 = t1 ^ x1;
+    AES_Plane y6 = y15 ^ x7;
+    AES_Plane y10 = y15 ^ t0;
+    AES_Plane y11 = y20 ^ y9;
+    AES_Plane y7 = x7 ^ y11;
+    AES_Plane y17 = y10 ^ y11;
+    AES_Plane y19 = y10 ^ y8;
+    AES_Plane y16 = t0 ^ y11;
+    AES_Plane y21 = y13 ^ y16;
+    AES_Plane y18 = x0 ^ y16;
+
+    // Non-linear section, inversion in GF(2^8)
+    AES_Plane t2 = y12 & y15;
+    AES_Plane t3 = y3 & y6;
+    AES_Plane t4 = t3 ^ t2;
+    AES_Plane t5 = y4 & x7;
+    AES_Plane t6 = t5 ^ t2;
+    AES_Plane t7 = y13 & y16;
+    AES_Plane t8 = y5 & y1;
+    AES_Plane t9 = t8 ^ t7;
+    AES_Plane t10 = y2 & y7;
+    AES_Plane t11 = t10 ^ t7;
+    AES_Plane t12 = y9 & y11;
+    AES_Plane t13 = y14 & y17;
+    AES_Plane t14 = t13 ^ t12;
+    AES_Plane t15 = y8 & y10;
+    AES_Plane t16 = t15 ^ t12;
+    AES_Plane t17 = t4 ^ t14;
+    AES_Plane t18 = t6 ^ t16;
+    AES_Plane t19 = t9 ^ t14;
+    AES_Plane t20 = t11 ^ t16;
+    AES_Plane t21 = t17 ^ y20;
+    AES_Plane t22 = t18 ^ y19;
+    AES_Plane t23 = t19 ^ y21;
+    AES_Plane t24 = t20 ^ y18;
+
+    AES_Plane t25 = t21 ^ t22;
+    AES_Plane t26 = t21 & t23;
+    AES_Plane t27 = t24 ^ t26;
+    AES_Plane t28 = t25 & t27;
+    AES_Plane t29 = t28 ^ t22;
+    AES_Plane t30 = t23 ^ t24;
+    AES_Plane t31 = t22 ^ t26;
+    AES_Plane t32 = t31 & t30;
+    AES_Plane t33 = t32 ^ t24;
+    AES_Plane t34 = t23 ^ t33;
+    AES_Plane t35 = t27 ^ t33;
+    AES_Plane t36 = t24 & t35;
+    AES_Plane t37 = t36 ^ t34;
+    AES_Plane t38 = t27 ^ t36;
+    AES_Plane t39 = t29 & t38;
+    AES_Plane t40 = t25 ^ t39;
+
+    AES_Plane t41 = t40 ^ t37;
+    AES_Plane t42 = t29 ^ t33;
+    AES_Plane t43 = t29 ^ t40;
+    AES_Plane t44 = t33 ^ t37;
+    AES_Plane t45 = t42 ^ t41;
+    AES_Plane z0 = t44 & y15;
+    AES_Plane z1 = t37 & y6;
+    AES_Plane z2 = t33 & x7;
+    AES_Plane z3 = t43 & y16;
+    AES_Plane z4 = t40 & y1;
+    AES_Plane z5 = t29 & y7;
+    AES_Plane z6 = t42 & y11;
+    AES_Plane z7 = t45 & y17;
+    AES_Plane z8 = t41 & y10;
+    AES_Plane z9 = t44 & y12;
+    AES_Plane z10 = t37 & y3;
+    AES_Plane z11 = t33 & y4;
+    AES_Plane z12 = t43 & y13;
+    AES_Plane z13 = t40 & y5;
+    AES_Plane z14 = t29 & y2;
+    AES_Plane z15 = t42 & y9;
+    AES_Plane z16 = t45 & y14;
+    AES_Plane z17 = t41 & y8;
+
+    // Bottom linear transformation
+    AES_Plane t46 = z15 ^ z16;
+    AES_Plane t47 = z10 ^ z11;
+    AES_Plane t48 = z5 ^ z13;
+    AES_Plane t49 = z9 ^ z10;
+    AES_Plane t50 = z2 ^ z12;
+    AES_Plane t51 = z2 ^ z5;
+    AES_Plane t52 = z7 ^ z8;
+    AES_Plane t53 = z0 ^ z3;
+    AES_Plane t54 = z6 ^ z7;
+    AES_Plane t55 = z16 ^ z17;
+    AES_Plane t56 = z12 ^ t48;
+    AES_Plane t57 = t50 ^ t53;
+    AES_Plane t58 = z4 ^ t46;
+    AES_Plane t59 = z3 ^ t54;
+    AES_Plane t60 = t46 ^ t57;
+    AES_Plane t61 = z14 ^ t57;
+    AES_Plane t62 = t52 ^ t58;
+    AES_Plane t63 = t49 ^ t58;
+    AES_Plane t64 = z4 ^ t59;
+    AES_Plane t65 = t61 ^ t62;
+    AES_Plane t66 = z1 ^ t63;
+    AES_Plane s0 = t59 ^ t63;
+    AES_Plane s6 = t56 ^ ~t62;
+    AES_Plane s7 = t48 ^ ~t60;
+    AES_Plane t67 = t64 ^ t65;
+    AES_Plane s3 = t53 ^ t66;
+    AES_Plane s4 = t51 ^ t66;
+    AES_Plane s5 = t47 ^ t65;
+    AES_Plane s1 = t64 ^ ~s3;
+    AES_Plane s2 = t55 ^ ~t67;
+
+    q[7] = s0;
+    q[6] = s1;
+    q[5] = s2;
+    q[4] = s3;
+    q[3] = s4;
+    q[2] = s5;
+    q[1] = s6;
+    q[0] = s7;
+}
+
+// Linear part of the inverse affine transformation of the S-box
+inline void AES_BitslicedInvAffine(AES_Plane *q) {
+    AES_Plane copy[8];
+    memcpy(copy, q, sizeof(copy));
+    for (uint32_t i = 0; i < 8; i++) {
+        q[i] = copy[(i + 2) & 7u] ^ copy[(i + 5) & 7u] ^ copy[(i + 7) & 7u];
+    }
+}
+
+// S^-1(y) = A^-1(S(A^-1(y))) with A^-1(y) = L(y) ^ 0x05, the circuit above already inverts in GF(2^8)
+inline void AES_BitslicedInvSubBytes(AES_Plane *q) {
+    AES_BitslicedInvAffine(q);
+    q[0] = ~q[0];
+    q[2] = ~q[2];
+    AES_BitslicedSubBytes(q);
+    AES_BitslicedInvAffine(q);
+    q[0] = ~q[0];
+    q[2] = ~q[2];
+}
+
+inline void AES_BitslicedShuffle(AES_Plane *q, AES_Plane mask) {
+    for (uint32_t i = 0; i < 8; i++) {
+        q[i] = AES_Shuffle(q[i], mask);
+    }
+}
+
+// Multiplication by x modulo x^8 + x^4 + x^3 + x + 1
+inline void AES_BitslicedXTime(AES_Plane *q) {
+    AES_Plane high = q[7];
+    q[7] = q[6];
+    q[6] = q[5];
+    q[5] = q[4];
+    q[4] = q[3] ^ high;
+    q[3] = q[2] ^ high;
+    q[2] = q[1];
+    q[1] = q[0] ^ high;
+    q[0] = high;
+}
+
+// out_r = 2 * (a_r ^ a_r+1) ^ a_r+1 ^ a_r+2 ^ a_r+3
+inline void AES_BitslicedMixColumns(AES_Plane *q) {
+    AES_Plane doubled[8];
+    AES_Plane rest[8];
+    for (uint32_t i = 0; i < 8; i++) {
+        AES_Plane rotated = AES_Shuffle(q[i], AES_ROTATE_COLUMN_1);
+        doubled[i] = q[i] ^ rotated;
+        rest[i] = rotated ^ AES_Shuffle(q[i], AES_ROTATE_COLUMN_2) ^ AES_Shuffle(q[i], AES_ROTATE_COLUMN_3);
+    }
+    AES_BitslicedXTime(doubled);
+    for (uint32_t i = 0; i < 8; i++) {
+        q[i] = doubled[i] ^ rest[i];
+    }
+}
+
+// InvMixColumns = MixColumns after a_r ^= 4 * (a_r ^ a_r+2)
+inline void AES_BitslicedInvMixColumns(AES_Plane *q) {
+    AES_Plane quadrupled[8];
+    for (uint32_t i = 0; i < 8; i++) {
+        quadrupled[i] = q[i] ^ AES_Shuffle(q[i], AES_ROTATE_COLUMN_2);
+    }
+    AES_BitslicedXTime(quadrupled);
+    AES_BitslicedXTime(quadrupled);
+    for (uint32_t i = 0; i < 8; i++) {
+        q[i] ^= quadrupled[i];
+    }
+    AES_BitslicedMixColumns(q);
+}
+
+inline void AES_BitslicedAddRoundKey(AES_Plane *q, const uint8_t *round_key) {
+    for (uint32_t i = 0; i < 8; i++) {
+        AES_Plane key_plane;
+        memcpy(&key_plane, round_key + i * 16, 16);
+        q[i] ^= key_plane;
+    }
+}
+
+inline void AES_BitslicedLoad(AES_Plane *q, const uint8_t *blocks) {
+    memcpy(q, blocks, AES_BITSLICED_LANES * 16);
+    AES_Transpose(q);
+}
+
+inline void AES_BitslicedStore(AES_Plane *q, uint8_t *blocks) {
+    AES_Transpose(q);
+    memcpy(blocks, q, AES_BITSLICED_LANES * 16);
+}
+
+void AES_EncryptBitsliced(uint8_t *blocks, const uint8_t *round_keys, uint32_t rounds) {
+    AES_Plane q[8];
+    AES_BitslicedLoad(q, blocks);
+    AES_BitslicedAddRoundKey(q, round_keys);
+    for (uint32_t round = 1; round < rounds; round++) {
+        AES_BitslicedSubBytes(q);
+        AES_BitslicedShuffle(q, AES_SHIFT_ROWS);
+        AES_BitslicedMixColumns(q);
+        AES_BitslicedAddRoundKey(q, round_keys + round * 128);
+    }
+    AES_BitslicedSubBytes(q);
+    AES_BitslicedShuffle(q, AES_SHIFT_ROWS);
+    AES_BitslicedAddRoundKey(q, round_keys + rounds * 128);
+    AES_BitslicedStore(q, blocks);
+}
+
+void AES_DecryptBitsliced(uint8_t *blocks, const uint8_t *round_keys, uint32_t rounds) {
+    AES_Plane q[8];
+    AES_BitslicedLoad(q, blocks);
+    AES_BitslicedAddRoundKey(q, round_keys + rounds * 128);
+    AES_BitslicedShuffle(q, AES_INV_SHIFT_ROWS);
+    AES_BitslicedInvSubBytes(q);
+    for (uint32_t round = rounds - 1; round > 0; round--) {
+        AES_BitslicedAddRoundKey(q, round_keys + round * 128);
+        AES_BitslicedInvMixColumns(q);
+        AES_BitslicedShuffle(q, AES_INV_SHIFT_ROWS);
+        AES_BitslicedInvSubBytes(q);
+    }
+    AES_BitslicedAddRoundKey(q, round_keys);
+    AES_BitslicedStore(q, blocks);
+}
+
+void AES::BuildBitslicedKeyExpansion() {
+    // A round key is the same for every block, so its planes are whole bytes of 0x00 or 0xff
+    for (uint32_t round = 0; round <= rounds; round++) {
+        const uint8_t *round_key = key_expansion[round * 4];
+        for (uint32_t bit = 0; bit < 8; bit++) {
+            for (uint32_t byte = 0; byte < 16; byte++) {
+                bitsliced_keys[round][bit][byte] = ((round_key[byte] >> bit) & 1u) ? 0xff : 0x00;
+            }
+        }
+    }
+}
+
+void AES::EncryptBlocksBitsliced(uint8_t *blocks, size_t n) const {
+    size_t i = 0;
+    for (; i + AES_BITSLICED_LANES <= n; i += AES_BITSLICED_LANES) {
+        AES_EncryptBitsliced(blocks + i * 16, bitsliced_keys[0][0], rounds);
+    }
+    if (i < n) {
+        uint8_t tail[AES_BITSLICED_LANES * 16]{};
+        memcpy(tail, blocks + i * 16, (n - i) * 16);
+        AES_EncryptBitsliced(tail, bitsliced_keys[0][0], rounds);
+        memcpy(blocks + i * 16, tail, (n - i) * 16);
+    }
+}
+
+void AES::DecryptBlocksBitsliced(uint8_t *blocks, size_t n) const {
+    size_t i = 0;
+    for (; i + AES_BITSLICED_LANES <= n; i += AES_BITSLICED_LANES) {
+        AES_DecryptBitsliced(blocks + i * 16, bitsliced_keys[0][0], rounds);
+    }
+    if (i < n) {
+        uint8_t tail[AES_BITSLICED_LANES * 16]{};
+        memcpy(tail, blocks + i * 16, (n - i) * 16);
+        AES_DecryptBitsliced(tail, bitsliced_keys[0][0], rounds);
+        memcpy(blocks + i * 16, tail, (n - i) * 16);
+    }
+}
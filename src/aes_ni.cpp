@@ -0,0 +1,103 @@
+#include <crypto330/block/aes.hpp>
+#include <crypto330/utils.hpp>
+
+#ifdef CRYPTO330_X86
+
+#include <immintrin.h>
+
+// Encryption round keys are the FIPS-197 byte schedule from BuildKeyExpansion, which already has
+// the byte order AESENC expects, so only the decryption keys need a separate AESIMC pass.
+
+__attribute__((target("aes,sse2")))
+void AES::BuildAesNiKeyExpansion() {
+    for (uint32_t round = 0; round <= rounds; round++) {
+        __m128i round_key = _mm_loadu_si128(reinterpret_cast<const __m128i *>(key_expansion[(rounds - round) * 4]));
+        if (round != 0 && round != rounds) {
+            round_key = _mm_aesimc_si128(round_key);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(aesni_decrypt_keys[round]), round_key);
+    }
+}
+
+// AESENC has a latency of several cycles but a throughput of one per cycle,
+// so Lanes independent blocks are kept in flight through each round
+template<uint32_t Lanes, bool Encryption>
+__attribute__((target("aes,sse2"), always_inline))
+inline void AES_ProcessAesNi(uint8_t *blocks, const uint8_t *round_keys_bytes, uint32_t rounds) {
+    auto round_keys = reinterpret_cast<const __m128i *>(round_keys_bytes);
+    __m128i state[Lanes];
+    __m128i round_key = _mm_loadu_si128(round_keys);
+    for (uint32_t lane = 0; lane < Lanes; lane++) {
+        state[lane] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(blocks + lane * 16));
+        state[lane] = _mm_xor_si128(state[lane], round_key);
+    }
+    for (uint32_t round = 1; round < rounds; round++) {
+        round_key = _mm_loadu_si128(round_keys + round);
+        for (uint32_t lane = 0; lane < Lanes; lane++) {
+            state[lane] = Encryption ? _mm_aesenc_si128(state[lane], round_key)
+                                     : _mm_aesdec_si128(state[lane], round_key);
+        }
+    }
+    round_key = _mm_loadu_si128(round_keys + rounds);
+    for (uint32_t lane = 0; lane < Lanes; lane++) {
+        state[lane] = Encryption ? _mm_aesenclast_si128(state[lane], round_key)
+                                 : _mm_aesdeclast_si128(state[lane], round_key);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(blocks + lane * 16), state[lane]);
+    }
+}
+
+__attribute__((target("aes,sse2")))
+void AES::EncryptBlockAesNi(uint8_t *block) const {
+    AES_ProcessAesNi<1, true>(block, key_expansion[0], rounds);
+}
+
+__attribute__((target("aes,sse2")))
+void AES::DecryptBlockAesNi(uint8_t *block) const {
+    AES_ProcessAesNi<1, false>(block, aesni_decrypt_keys[0], rounds);
+}
+
+__attribute__((target("aes,sse2")))
+void AES::EncryptBlocksAesNi(uint8_t *blocks, size_t n) const {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        AES_ProcessAesNi<8, true>(blocks + i * 16, key_expansion[0], rounds);
+    }
+    for (; i < n; i++) {
+        AES_ProcessAesNi<1, true>(blocks + i * 16, key_expansion[0], rounds);
+    }
+}
+
+__attribute__((target("aes,sse2")))
+void AES::DecryptBlocksAesNi(uint8_t *blocks, size_t n) const {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        AES_ProcessAesNi<8, false>(blocks + i * 16, aesni_decrypt_keys[0], rounds);
+    }
+    for (; i < n; i++) {
+        AES_ProcessAesNi<1, false>(blocks + i * 16, aesni_decrypt_keys[0], rounds);
+    }
+}
+
+#else
+
+// AESNI is never selected on other architectures, these keep the engine switch linkable
+
+void AES::BuildAesNiKeyExpansion() {}
+
+void AES::EncryptBlockAesNi(uint8_t *block) const {
+    EncryptBlockTTable(block);
+}
+
+void AES::DecryptBlockAesNi(uint8_t *block) const {
+    DecryptBlockTTable(block);
+}
+
+void AES::EncryptBlocksAesNi(uint8_t *blocks, size_t n) const {
+    EncryptBlocksTTable(blocks, n);
+}
+
+void AES::DecryptBlocksAesNi(uint8_t *blocks, size_t n) const {
+    DecryptBlocksTTable(blocks, n);
+}
+
+#endif
@@ -1,5 +1,10 @@
 #include <crypto330/block/block.hpp>
-#include <fstream>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <memory>
 
 void BlockEncryption::Encrypt(std::vector<uint8_t> &data) const {
     ProcessData(data, true);
@@ -9,39 +14,213 @@ void BlockEncryption::Decrypt(std::vector<uint8_t> &data) const {
     ProcessData(data, false);
 }
 
-void BlockEncryption::ProcessFile(const std::string &source, const std::string &destination, bool encrypt) const {
+size_t BlockEncryption::Encrypt(const uint8_t *in, size_t length, uint8_t *out, size_t capacity) const {
+    size_t size = GetPaddedSize(length);
+    if (capacity < size) {
+        return 0;
+    }
+    std::memmove(out, in, length);
+    std::fill(out + length, out + size, 0);
+    ProcessBlocksParallel(out, size / block_bytes, true);
+    return size;
+}
+
+size_t BlockEncryption::Decrypt(const uint8_t *in, size_t length, uint8_t *out, size_t capacity) const {
+    assert(length % block_bytes == 0);
+    if (capacity < length) {
+        return 0;
+    }
+    std::memmove(out, in, length);
+    ProcessBlocksParallel(out, length / block_bytes, false);
+    return length;
+}
+
+size_t BlockEncryption::GetPaddedSize(size_t length) const {
+    return (length + block_bytes - 1) / block_bytes * block_bytes;
+}
+
+const size_t BUFFER_ALIGNMENT = 64;
+
+struct AlignedBufferDeleter {
+    void operator()(uint8_t *buffer) const {
+        operator delete[](buffer, std::align_val_t(BUFFER_ALIGNMENT));
+    }
+};
+
+const char FILE_MAGIC[4] = {'C', '3', '3', '0'};
+
+static_assert(sizeof(BlockEncryption::FileHeader) == 96, "FileHeader layout must not depend on the compiler");
+
+uint64_t BlockEncryption::FileHeader::GetChunkCount() const {
+    return (length + chunk_bytes - 1) / chunk_bytes;
+}
+
+BlockEncryption::FileHeader BlockEncryption::CreateFileHeader(uint64_t length, uint64_t chunk_bytes) const {
+    FileHeader header{};
+    std::copy(FILE_MAGIC, FILE_MAGIC + 4, header.magic);
+    header.version = FILE_VERSION;
+    header.cipher_id = cipher_id;
+    header.length = length;
+    header.chunk_bytes = chunk_bytes;
+    return header;
+}
+
+bool BlockEncryption::ReadFileHeader(const std::string &path, FileHeader &header) {
+    std::ifstream in(path.c_str(), std::ios_base::binary);
+    in.read(reinterpret_cast<char *>(&header), sizeof(FileHeader));
+    return in && std::equal(FILE_MAGIC, FILE_MAGIC + 4, header.magic) && header.version == FILE_VERSION &&
+           header.chunk_bytes > 0 && header.chunk_bytes <= MAX_CHUNK_BYTES && header.iv_bytes <= sizeof(header.iv);
+}
+
+BlockEncryption::FileStats BlockEncryption::EncryptFile(const std::string &source, const std::string &destination,
+                                                        uint64_t chunk_bytes) const {
+    assert(chunk_bytes > 0 && chunk_bytes <= MAX_CHUNK_BYTES && chunk_bytes % block_bytes == 0);
     std::ifstream in(source.c_str(), std::ios_base::binary);
     std::ofstream out(destination.c_str(), std::ios_base::binary);
+    if (!in || !out) {
+        return FileStats();
+    }
 
     in.seekg(0, std::ios::end);
-    size_t length = in.tellg();
+    uint64_t length = in.tellg();
     in.seekg(0, std::ios::beg);
 
-    const size_t CHUNK_SIZE = 1024 * 1024 * 16;
-    uint8_t chunk[CHUNK_SIZE];
-    for (size_t i = 0; i < (length + CHUNK_SIZE - 1) / CHUNK_SIZE; i++) {
-        uint32_t size = std::min(CHUNK_SIZE, length - i * CHUNK_SIZE);
-        std::fill(chunk, chunk + CHUNK_SIZE, 0);
-        in.read(reinterpret_cast<char *>(chunk), size);
-#pragma omp parallel for
-        for (uint32_t byte = 0; byte < size; byte += block_bytes) {
-            (encrypt ? EncryptBlock(chunk + byte) : DecryptBlock(chunk + byte));
-        }
-        out.write(reinterpret_cast<char *>(chunk), ((size + block_bytes - 1) / block_bytes) * block_bytes);
+    FileHeader header = CreateFileHeader(length, chunk_bytes);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(FileHeader));
+
+    uint64_t padded_length = GetPaddedSize(length);
+    return ProcessFile(in, out, length, padded_length, chunk_bytes, true);
+}
+
+BlockEncryption::FileStats BlockEncryption::DecryptFile(const std::string &source, const std::string &destination) const {
+    return DecryptFileChunks(source, destination, 0, UINT64_MAX);
+}
+
+BlockEncryption::FileStats BlockEncryption::DecryptFileChunks(const std::string &source, const std::string &destination,
+                                                              uint64_t first_chunk, uint64_t chunks) const {
+    FileHeader header{};
+    if (!ReadFileHeader(source, header) || header.cipher_id != cipher_id || header.mode != 0 ||
+        header.chunk_bytes % block_bytes != 0) {
+        return FileStats();
+    }
+    std::ifstream in(source.c_str(), std::ios_base::binary);
+    std::ofstream out(destination.c_str(), std::ios_base::binary);
+    if (!in || !out) {
+        return FileStats();
     }
 
-    in.close();
+    in.seekg(0, std::ios::end);
+    uint64_t file_size = in.tellg();
+    uint64_t padded_length = GetPaddedSize(header.length);
+    if (file_size < sizeof(FileHeader) + padded_length) {
+        return FileStats();
+    }
+
+    first_chunk = std::min(first_chunk, header.GetChunkCount());
+    chunks = std::min(chunks, header.GetChunkCount() - first_chunk);
+    uint64_t offset = first_chunk * header.chunk_bytes;
+    uint64_t input_length = std::min(chunks * header.chunk_bytes, padded_length - offset);
+    uint64_t output_length = std::min(chunks * header.chunk_bytes, header.length - offset);
+    in.seekg(sizeof(FileHeader) + offset, std::ios::beg);
+    return ProcessFile(in, out, input_length, output_length, header.chunk_bytes, false);
+}
+
+double BlockEncryption::FileStats::GetThroughput() const {
+    return seconds > 0 ? bytes / seconds / (1024 * 1024) : 0;
+}
+
+BlockEncryption::FileStats BlockEncryption::ProcessFile(std::ifstream &in, std::ofstream &out, uint64_t input_length,
+                                                        uint64_t output_length, uint64_t chunk_bytes,
+                                                        bool encrypt) const {
+    auto start = std::chrono::steady_clock::now();
+
+    // Three buffers rotate between reading chunk i + 1, encrypting chunk i and writing chunk i - 1.
+    // Reads and writes are sequential and each runs in its own task, so plain streams are enough.
+    const size_t BUFFERS = 3;
+    std::unique_ptr<uint8_t[], AlignedBufferDeleter> buffers[BUFFERS];
+    for (auto &buffer : buffers) {
+        buffer.reset(new(std::align_val_t(BUFFER_ALIGNMENT)) uint8_t[chunk_bytes]);
+    }
+
+    uint64_t chunks = (input_length + chunk_bytes - 1) / chunk_bytes;
+    auto read_chunk = [&](uint64_t chunk) {
+        uint64_t size = std::min(chunk_bytes, input_length - chunk * chunk_bytes);
+        in.read(reinterpret_cast<char *>(buffers[chunk % BUFFERS].get()), size);
+        return in ? size : 0;
+    };
+
+    bool success = true;
+    std::future<uint64_t> read_future;
+    std::future<bool> write_future;
+    if (chunks > 0) {
+        read_future = std::async(std::launch::async, read_chunk, 0);
+    }
+    for (uint64_t i = 0; i < chunks; i++) {
+        uint64_t size = read_future.get();
+        success &= size > 0;
+        if (i + 1 < chunks) {
+            // The buffer of chunk i + 1 was last written out as chunk i - 2, which has already finished
+            read_future = std::async(std::launch::async, read_chunk, i + 1);
+        }
+
+        uint8_t *chunk = buffers[i % BUFFERS].get();
+        uint64_t padded_size = (size + block_bytes - 1) / block_bytes * block_bytes;
+        std::fill(chunk + size, chunk + padded_size, 0);
+        ProcessBlocksParallel(chunk, padded_size / block_bytes, encrypt);
+
+        if (write_future.valid()) {
+            success &= write_future.get();
+        }
+        uint64_t write_size = std::min(padded_size, output_length - std::min(output_length, i * chunk_bytes));
+        write_future = std::async(std::launch::async, [&out, chunk, write_size] {
+            out.write(reinterpret_cast<const char *>(chunk), write_size);
+            return static_cast<bool>(out);
+        });
+    }
+    if (write_future.valid()) {
+        success &= write_future.get();
+    }
     out.close();
+
+    FileStats stats;
+    stats.success = success && out;
+    stats.bytes = encrypt ? input_length : output_length;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
 }
 
 void BlockEncryption::ProcessData(std::vector<uint8_t> &data, bool encryption) const {
-    while (data.size() % block_bytes != 0) data.push_back(0x00);
+    data.resize(GetPaddedSize(data.size()));
+    ProcessBlocksParallel(data.data(), data.size() / block_bytes, encryption);
+}
+
+void BlockEncryption::ProcessBlocksParallel(uint8_t *blocks, size_t n, bool encryption) const {
+    // Each thread takes batches of blocks so the cipher can interleave them
+    const size_t BATCH_BLOCKS = 256;
 #pragma omp parallel for
-    for (size_t byte = 0; byte < data.size(); byte += block_bytes) {
-        (encryption ? EncryptBlock(data.data() + byte) : DecryptBlock(data.data() + byte));
+    for (size_t first = 0; first < n; first += BATCH_BLOCKS) {
+        size_t count = std::min(BATCH_BLOCKS, n - first);
+        uint8_t *batch = blocks + first * block_bytes;
+        (encryption ? EncryptBlocks(batch, count) : DecryptBlocks(batch, count));
+    }
+}
+
+void BlockEncryption::EncryptBlocks(uint8_t *blocks, size_t n) const {
+    for (size_t i = 0; i < n; i++) {
+        EncryptBlock(blocks + i * block_bytes);
+    }
+}
+
+void BlockEncryption::DecryptBlocks(uint8_t *blocks, size_t n) const {
+    for (size_t i = 0; i < n; i++) {
+        DecryptBlock(blocks + i * block_bytes);
     }
 }
 
 uint64_t BlockEncryption::GetBlockBytes() const {
     return block_bytes;
 }
+
+uint16_t BlockEncryption::GetCipherId() const {
+    return cipher_id;
+}
@@ -1,248 +1,671 @@
 #include <crypto330/stream/block_stream.hpp>
+#include <crypto330/stream/ghash.hpp>
+#include <crypto330/hash/hmac.hpp>
+#include <crypto330/random.hpp>
+#include <crypto330/utils.hpp>
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstring>
+#include <fstream>
 
 BlockStreamEncryption::BlockStreamEncryption(std::unique_ptr<BlockEncryption> &&encryption) : encryption(std::move(encryption)) {}
 
+BlockStreamEncryption::BlockStreamEncryption(std::unique_ptr<BlockEncryption> &&encryption, std::unique_ptr<Hash> &&mac,
+                                             const std::string &mac_key, bool hex)
+        : encryption(std::move(encryption)), mac(std::move(mac)),
+          mac_key(hex ? HexStringToBytes(mac_key) : StringToBytes(mac_key)) {}
+
 void BlockStreamEncryption::Encrypt(std::vector<uint8_t> &data, BlockStreamEncryption::Mode mode) const {
+    size_t length = data.size();
+    data.resize(GetEncryptedSize(length, mode));
+    Encrypt(data.data(), length, data.data(), data.size(), mode);
+}
+
+bool BlockStreamEncryption::Decrypt(std::vector<uint8_t> &data, BlockStreamEncryption::Mode mode) const {
+    size_t size = Decrypt(data.data(), data.size(), data.data(), data.size(), mode);
+    if (size == AUTHENTICATION_FAILED) {
+        data.clear();
+        return false;
+    }
+    data.resize(size);
+    return true;
+}
+
+size_t BlockStreamEncryption::Encrypt(const uint8_t *in, size_t length, uint8_t *out, size_t capacity,
+                                      Mode mode) const {
+    if (capacity < GetEncryptedSize(length, mode)) {
+        return 0;
+    }
     switch (mode) {
         case Mode::ECB:
-            EncryptECB(data);
-            break;
+            return EncryptECB(in, length, out);
         case Mode::CBC:
-            EncryptCBC(data);
-            break;
-        case Mode::CFB:
-            EncryptCFB(data);
-            break;
-        case Mode::OFB:
-            EncryptOFB(data);
-            break;
-        case Mode::CTR:
-            EncryptCTR(data);
-            break;
+            return EncryptCBC(in, length, out);
+        case Mode::GCM: {
+            // ciphertext || iv || tag
+            uint8_t iv[GCM_IV_BYTES];
+            GenerateIV(iv, GCM_IV_BYTES);
+            EncryptGCM(iv, nullptr, 0, in, out, length, out + length + GCM_IV_BYTES);
+            std::copy(iv, iv + GCM_IV_BYTES, out + length);
+            return length + GCM_IV_BYTES + GCM_TAG_BYTES;
+        }
+        case Mode::CTR_HMAC:
+            return EncryptCTRHMAC(in, length, out);
+        default:
+            return EncryptStream(in, length, out, mode);
     }
 }
 
-void BlockStreamEncryption::Decrypt(std::vector<uint8_t> &data, BlockStreamEncryption::Mode mode) const {
+size_t BlockStreamEncryption::Decrypt(const uint8_t *in, size_t length, uint8_t *out, size_t capacity,
+                                      Mode mode) const {
+    if (capacity < length) {
+        return 0;
+    }
     switch (mode) {
         case Mode::ECB:
-            DecryptECB(data);
-            break;
+            return DecryptECB(in, length, out);
         case Mode::CBC:
-            DecryptCBC(data);
-            break;
-        case Mode::CFB:
-            DecryptCFB(data);
-            break;
-        case Mode::OFB:
-            DecryptOFB(data);
-            break;
-        case Mode::CTR:
-            DecryptCTR(data);
-            break;
-    }
-}
-
-void BlockStreamEncryption::EncryptECB(std::vector<uint8_t> &data) const {
-    uint64_t origin_size = data.size();
-    uint64_t block_size = encryption->GetBlockBytes();
-    AlignData(data, block_size);
-#pragma omp parallel for
-    for (size_t byte = 0; byte < data.size(); byte += block_size) {
-        encryption->EncryptBlock(data.data() + byte);
+            return DecryptCBC(in, length, out);
+        case Mode::GCM: {
+            // Truncated input cannot hold the IV and tag
+            if (length < GCM_IV_BYTES + GCM_TAG_BYTES) {
+                return AUTHENTICATION_FAILED;
+            }
+            size_t size = length - GCM_IV_BYTES - GCM_TAG_BYTES;
+            return DecryptGCM(in + size, nullptr, 0, in, out, size, in + size + GCM_IV_BYTES)
+                   ? size : AUTHENTICATION_FAILED;
+        }
+        case Mode::CTR_HMAC:
+            return DecryptCTRHMAC(in, length, out);
+        default:
+            return DecryptStream(in, length, out, mode);
     }
-
-    PushUint64(data, origin_size);
 }
 
-void BlockStreamEncryption::DecryptECB(std::vector<uint8_t> &data) const {
-    uint64_t origin_size = PopUint64(data);
-    uint64_t block_size = encryption->GetBlockBytes();
-    AlignData(data, block_size);
-#pragma omp parallel for
-    for (size_t byte = 0; byte < data.size(); byte += block_size) {
-        encryption->DecryptBlock(data.data() + byte);
+size_t BlockStreamEncryption::GetEncryptedSize(size_t length, Mode mode) const {
+    switch (mode) {
+        case Mode::ECB:
+            return encryption->GetPaddedSize(length) + sizeof(uint64_t);
+        case Mode::CBC:
+            return encryption->GetBlockBytes() + encryption->GetPaddedSize(length) + sizeof(uint64_t);
+        case Mode::GCM:
+            return length + GCM_IV_BYTES + GCM_TAG_BYTES;
+        case Mode::CTR_HMAC:
+            // Nothing is written without a MAC
+            return mac ? length + encryption->GetBlockBytes() + mac->GetDigestSize() : 0;
+        default:
+            return length + encryption->GetBlockBytes();
     }
+}
 
-    assert(data.size() >= origin_size);
-    data.resize(origin_size);
+BlockStreamEncryption::Context::Context(const BlockStreamEncryption &stream, Mode mode, bool encryption)
+        : stream(&stream), mode(mode), encryption(encryption) {
+    block_size = stream.encryption->GetBlockBytes();
+    segment_size = mode == Mode::CFB8 ? 1 : block_size;
+    assert(mode == Mode::ECB || block_size >= 16);
+    assert(mode != Mode::GCM && mode != Mode::CTR_HMAC);
 }
 
-void BlockStreamEncryption::PushUint64(std::vector<uint8_t> &data, uint64_t value) const {
-    data.resize(data.size() + sizeof(uint64_t));
-    *reinterpret_cast<uint64_t*>(data.data() + data.size() - sizeof(uint64_t)) = value;
+void BlockStreamEncryption::Context::Init(const uint8_t *iv) {
+    // ECB has no IV and passes nullptr
+    assert(mode == Mode::ECB || iv != nullptr);
+    if (mode != Mode::ECB && iv != nullptr) {
+        std::copy(iv, iv + block_size, state);
+        std::copy(iv, iv + block_size, window);
+    }
+    buffered = 0;
+    window_position = 0;
+    position = 0;
 }
 
-uint64_t BlockStreamEncryption::PopUint64(std::vector<uint8_t> &data) const {
-    assert(data.size() >= sizeof(uint64_t));
-    uint64_t value = *reinterpret_cast<uint64_t*>(data.data() + data.size() - sizeof(uint64_t));
-    data.resize(data.size() - sizeof(uint64_t));
-    return value;
+size_t BlockStreamEncryption::Context::Update(const uint8_t *in, uint8_t *out, size_t length) {
+    position += length;
+    if (mode == Mode::CTR) {
+        std::memmove(out, in, length);
+        stream->ApplyCTR(out, length, state, position - length);
+        return length;
+    }
+    if (mode != Mode::ECB && mode != Mode::CBC) {
+        std::memmove(out, in, length);
+        (mode == Mode::OFB ? ProcessOFB(out, length) : ProcessCFB(out, length));
+        return length;
+    }
+
+    // ECB and CBC: full blocks are moved to out and processed there, the rest is kept in buffer
+    uint64_t first_block = 0;
+    if (buffered > 0) {
+        uint64_t bytes = std::min<uint64_t>(block_size - buffered, length);
+        std::copy(in, in + bytes, buffer + buffered);
+        buffered += bytes;
+        in += bytes;
+        length -= bytes;
+        if (buffered < block_size) {
+            return 0;
+        }
+        first_block = 1;
+    }
+    uint64_t full = length / block_size * block_size;
+    uint64_t tail = length - full;
+    // The tail and the completed block are saved before the move, out may overlap in
+    uint8_t completed[BlockEncryption::MAX_BLOCK_BYTES];
+    std::copy(buffer, buffer + block_size, completed);
+    std::copy(in + full, in + length, buffer);
+    buffered = tail;
+    std::memmove(out + first_block * block_size, in, full);
+    if (first_block) {
+        std::copy(completed, completed + block_size, out);
+    }
+    uint64_t blocks = first_block + full / block_size;
+    ProcessBlocks(out, blocks);
+    return blocks * block_size;
 }
 
-void BlockStreamEncryption::AlignData(std::vector<uint8_t> & data, uint64_t block_size) const {
-    while (data.size() % block_size != 0) {
-        data.push_back(0x00);
+size_t BlockStreamEncryption::Context::Final(uint8_t *out) {
+    if ((mode != Mode::ECB && mode != Mode::CBC) || buffered == 0) {
+        return 0;
     }
+    std::fill(buffer + buffered, buffer + block_size, 0);
+    std::copy(buffer, buffer + block_size, out);
+    buffered = 0;
+    ProcessBlocks(out, 1);
+    return block_size;
 }
 
-void BlockStreamEncryption::EncryptCBC(std::vector<uint8_t> &data) const {
-    uint64_t origin_size = data.size();
-    uint64_t block_size = encryption->GetBlockBytes();
-    AlignData(data, block_size);
-    auto iv = GenerateIV(block_size);
+void BlockStreamEncryption::Context::ProcessBlocks(uint8_t *blocks, uint64_t n) {
+    const BlockEncryption &cipher = *stream->encryption;
+    if (n == 0) {
+        return;
+    }
+    if (mode == Mode::ECB) {
+        cipher.ProcessBlocksParallel(blocks, n, encryption);
+    } else if (encryption) {
+        for (uint64_t i = 0; i < n; i++) {
+            uint8_t *block = blocks + i * block_size;
+            XorBytes(block, state, block_size);
+            cipher.EncryptBlock(block);
+            std::copy(block, block + block_size, state);
+        }
+    } else {
+        uint8_t last[BlockEncryption::MAX_BLOCK_BYTES];
+        std::copy(blocks + (n - 1) * block_size, blocks + n * block_size, last);
+        stream->DecryptCBCBlocks(blocks, n, state);
+        std::copy(last, last + block_size, state);
+    }
+}
 
-    data.insert(data.begin(), iv.begin(), iv.end());
+void BlockStreamEncryption::Context::ProcessOFB(uint8_t *data, uint64_t length) {
+    // buffered is the number of bytes of state already used
+    while (length > 0) {
+        if (buffered == 0) {
+            stream->encryption->EncryptBlock(state);
+        }
+        uint64_t bytes = std::min(block_size - buffered, length);
+        XorBytes(data, state + buffered, bytes);
+        buffered = (buffered + bytes) % block_size;
+        data += bytes;
+        length -= bytes;
+    }
+}
 
-    for (size_t byte = 0; byte < data.size(); byte += block_size) {
-        for(uint64_t i = 0; i < block_size && byte; i++) {
-            data[byte+i] ^= data[byte + i - block_size];
+void BlockStreamEncryption::Context::ProcessCFB(uint8_t *data, uint64_t length) {
+    // Sliding shift register: the register is window[window_position, window_position + block_size),
+    // ciphertext of the current segment is appended behind it and the window slides back once it is full.
+    // buffered is the number of bytes of the current segment already processed.
+    while (length > 0) {
+        if (!encryption && buffered == 0 && length >= segment_size) {
+            // Whole segments: all registers are known from the ciphertext, decrypt them in parallel
+            uint64_t bytes = length / segment_size * segment_size;
+            uint8_t next[BlockEncryption::MAX_BLOCK_BYTES];
+            uint64_t kept = bytes < block_size ? block_size - bytes : 0;
+            std::copy(window + window_position + block_size - kept, window + window_position + block_size, next);
+            std::copy(data + bytes - (block_size - kept), data + bytes, next + kept);
+            stream->DecryptCFBSegments(data, bytes, window + window_position, segment_size);
+            std::copy(next, next + block_size, window);
+            window_position = 0;
+            data += bytes;
+            length -= bytes;
+            continue;
+        }
+        if (buffered == 0) {
+            if (window_position + block_size + segment_size > 2 * block_size) {
+                std::copy(window + window_position, window + window_position + block_size, window);
+                window_position = 0;
+            }
+            std::copy(window + window_position, window + window_position + block_size, buffer);
+            stream->encryption->EncryptBlock(buffer);
+        }
+        uint64_t bytes = std::min(segment_size - buffered, length);
+        uint8_t *ciphertext = window + window_position + block_size + buffered;
+        if (!encryption) {
+            std::copy(data, data + bytes, ciphertext);
+        }
+        XorBytes(data, buffer + buffered, bytes);
+        if (encryption) {
+            std::copy(data, data + bytes, ciphertext);
+        }
+        buffered += bytes;
+        if (buffered == segment_size) {
+            buffered = 0;
+            window_position += segment_size;
         }
-        encryption->EncryptBlock(data.data() + byte);
+        data += bytes;
+        length -= bytes;
     }
+}
 
-    PushUint64(data, origin_size);
+void BlockStreamEncryption::EncryptGCM(const uint8_t *iv, const uint8_t *aad, size_t aad_length, const uint8_t *in,
+                                       uint8_t *out, size_t length, uint8_t *tag) const {
+    ProcessGCM(iv, aad, aad_length, in, out, length, tag, true);
 }
 
-void BlockStreamEncryption::DecryptCBC(std::vector<uint8_t> &data) const {
-    uint64_t origin_size = PopUint64(data);
-    uint64_t block_size = encryption->GetBlockBytes();
-    AlignData(data, block_size);
+bool BlockStreamEncryption::DecryptGCM(const uint8_t *iv, const uint8_t *aad, size_t aad_length, const uint8_t *in,
+                                       uint8_t *out, size_t length, const uint8_t *tag) const {
+    uint8_t expected[GCM_TAG_BYTES];
+    ProcessGCM(iv, aad, aad_length, in, out, length, expected, false);
+    uint8_t difference = 0;
+    for (size_t i = 0; i < GCM_TAG_BYTES; i++) {
+        difference |= expected[i] ^ tag[i];
+    }
+    if (difference != 0) {
+        std::fill(out, out + length, 0);
+    }
+    return difference == 0;
+}
 
-    for (size_t byte = data.size() - block_size; byte < data.size(); byte -= block_size) {
-        encryption->DecryptBlock(data.data() + byte);
-        for(uint64_t i = 0; i < block_size && byte; i++) {
-            data[byte+i] ^= data[byte + i - block_size];
+void BlockStreamEncryption::ProcessGCM(const uint8_t *iv, const uint8_t *aad, size_t aad_length, const uint8_t *in,
+                                       uint8_t *out, size_t length, uint8_t *tag, bool encrypt) const {
+    assert(encryption->GetBlockBytes() == 16);
+    // 2^32 - 2 blocks, the 128-bit CTR increment then matches the 32-bit GCM increment
+    assert(length <= (uint64_t(1) << 36u) - 32);
+    uint8_t h[16]{};
+    encryption->EncryptBlock(h);
+    GHash ghash(h);
+    ghash.Update(aad, aad_length);
+
+    // J0 = iv || 0^31 || 1, the keystream starts at J0 + 1
+    uint8_t counter[16]{};
+    std::copy(iv, iv + GCM_IV_BYTES, counter);
+    counter[15] = 1;
+    // Each tile is hashed right before (decryption) or after (encryption) the CTR pass, while it is in L1
+    const size_t TILE_BYTES = 4096;
+    for (size_t offset = 0; offset < length; offset += TILE_BYTES) {
+        size_t bytes = std::min(TILE_BYTES, length - offset);
+        if (!encrypt) {
+            ghash.Update(in + offset, bytes);
+        }
+        std::memmove(out + offset, in + offset, bytes);
+        ApplyCTR(out + offset, bytes, counter, 16 + offset);
+        if (encrypt) {
+            ghash.Update(out + offset, bytes);
         }
     }
-
-    data.erase(data.begin(), data.begin() + block_size);
-
-    assert(data.size() >= origin_size);
-    data.resize(origin_size);
+    ghash.Final(aad_length, length, tag);
+    encryption->EncryptBlock(counter);
+    XorBytes(tag, counter, GCM_TAG_BYTES);
 }
 
-std::vector<uint8_t> BlockStreamEncryption::GenerateIV(uint64_t bytes) const {
-    std::vector<uint8_t> iv(bytes);
-    for(uint64_t i = 0; i < bytes; i++) {
-        iv[i] = rand();
+size_t BlockStreamEncryption::EncryptCTRHMAC(const uint8_t *in, size_t length, uint8_t *out) const {
+    if (!mac) {
+        return 0;
     }
-    return iv;
+    uint64_t block_size = encryption->GetBlockBytes();
+    uint8_t iv[BlockEncryption::MAX_BLOCK_BYTES];
+    GenerateIV(iv, block_size);
+    ProcessCTRHMAC(iv, in, out, length, out + length + block_size, true);
+    std::copy(iv, iv + block_size, out + length);
+    return length + block_size + mac->GetDigestSize();
 }
 
-void BlockStreamEncryption::EncryptOFB(std::vector<uint8_t> &data) const {
+size_t BlockStreamEncryption::DecryptCTRHMAC(const uint8_t *in, size_t length, uint8_t *out) const {
+    if (!mac) {
+        return AUTHENTICATION_FAILED;
+    }
     uint64_t block_size = encryption->GetBlockBytes();
-    auto iv = GenerateIV(block_size);
-    auto state = iv;
-    for(size_t byte = 0; byte < data.size(); byte++) {
-        if (byte % block_size == 0) {
-            encryption->EncryptBlock(state.data());
-        }
-        data[byte] ^= state[byte % block_size];
+    uint64_t tag_size = mac->GetDigestSize();
+    // Truncated input cannot hold the IV and tag
+    if (length < block_size + tag_size) {
+        return AUTHENTICATION_FAILED;
     }
-    data.insert(data.end(), iv.begin(), iv.end());
+    size_t size = length - block_size - tag_size;
+    std::vector<uint8_t> tag(in + size + block_size, in + length);
+    std::vector<uint8_t> expected(tag_size);
+    ProcessCTRHMAC(in + size, in, out, size, expected.data(), false);
+
+    uint8_t difference = 0;
+    for (size_t i = 0; i < tag_size; i++) {
+        difference |= expected[i] ^ tag[i];
+    }
+    if (difference != 0) {
+        std::fill(out, out + size, 0);
+        return AUTHENTICATION_FAILED;
+    }
+    return size;
 }
 
-void BlockStreamEncryption::DecryptOFB(std::vector<uint8_t> &data) const {
+void BlockStreamEncryption::ProcessCTRHMAC(const uint8_t *iv, const uint8_t *in, uint8_t *out, size_t length,
+                                           uint8_t *tag, bool encrypt) const {
+    assert(mac);
     uint64_t block_size = encryption->GetBlockBytes();
-    auto iv = std::vector<uint8_t>(data.end()-block_size, data.end());
-    data.erase(data.end()-block_size, data.end());
-    auto state = iv;
-    for(size_t byte = 0; byte < data.size(); byte++) {
-        if (byte % block_size == 0) {
-            encryption->EncryptBlock(state.data());
+    uint64_t digest_size = mac->GetDigestSize();
+    // Each tile fits in L2, it is hashed right after (encryption) or before (decryption) its CTR pass
+    const size_t TILE_BYTES = 64 * 1024;
+    size_t tiles = (length + TILE_BYTES - 1) / TILE_BYTES;
+
+    // iv || digest of every tile || 64-bit length
+    std::vector<uint8_t> message(block_size + tiles * digest_size + sizeof(uint64_t));
+    std::copy(iv, iv + block_size, message.begin());
+    uint64_t length_word = length;
+    std::memcpy(message.data() + message.size() - sizeof(uint64_t), &length_word, sizeof(uint64_t));
+
+#pragma omp parallel for if (tiles > 1)
+    for (size_t tile = 0; tile < tiles; tile++) {
+        size_t offset = tile * TILE_BYTES;
+        size_t bytes = std::min(TILE_BYTES, length - offset);
+        if (encrypt) {
+            std::memmove(out + offset, in + offset, bytes);
+            ApplyCTR(out + offset, bytes, iv, offset);
+        }
+        const uint8_t *ciphertext = encrypt ? out + offset : in + offset;
+        auto digest = mac->GetHash(ciphertext, bytes);
+        std::copy(digest.begin(), digest.end(), message.begin() + block_size + tile * digest_size);
+        if (!encrypt) {
+            std::memmove(out + offset, in + offset, bytes);
+            ApplyCTR(out + offset, bytes, iv, offset);
         }
-        data[byte] ^= state[byte % block_size];
     }
+
+    auto result = Hmac(*mac, mac_key, message);
+    std::copy(result.begin(), result.end(), tag);
+}
+
+size_t BlockStreamEncryption::EncryptECB(const uint8_t *in, size_t length, uint8_t *out) const {
+    Context context(*this, Mode::ECB, true);
+    context.Init(nullptr);
+    size_t written = context.Update(in, out, length);
+    written += context.Final(out + written);
+
+    std::memcpy(out + written, &length, sizeof(uint64_t));
+    return written + sizeof(uint64_t);
+}
+
+size_t BlockStreamEncryption::DecryptECB(const uint8_t *in, size_t length, uint8_t *out) const {
+    assert(length >= sizeof(uint64_t) && (length - sizeof(uint64_t)) % encryption->GetBlockBytes() == 0);
+    uint64_t origin_size;
+    std::memcpy(&origin_size, in + length - sizeof(uint64_t), sizeof(uint64_t));
+    assert(origin_size <= length - sizeof(uint64_t));
+
+    Context context(*this, Mode::ECB, false);
+    context.Init(nullptr);
+    context.Update(in, out, length - sizeof(uint64_t));
+    return origin_size;
 }
 
-void BlockStreamEncryption::EncryptCTR(std::vector<uint8_t> &data) const {
+size_t BlockStreamEncryption::EncryptCBC(const uint8_t *in, size_t length, uint8_t *out) const {
+    // iv || ciphertext || length
     uint64_t block_size = encryption->GetBlockBytes();
-    uint64_t counter = 0;
-    auto iv = GenerateIV(block_size);
-    auto state = iv;
-    assert(block_size >= sizeof(uint64_t));
+    uint8_t iv[BlockEncryption::MAX_BLOCK_BYTES];
+    GenerateIV(iv, block_size);
+    Context context(*this, Mode::CBC, true);
+    context.Init(iv);
+    uint8_t *ciphertext = out + block_size;
+    size_t written = context.Update(in, ciphertext, length);
+    written += context.Final(ciphertext + written);
+    // Written last, out may be the same buffer as in
+    std::copy(iv, iv + block_size, out);
+
+    std::memcpy(ciphertext + written, &length, sizeof(uint64_t));
+    return block_size + written + sizeof(uint64_t);
+}
 
-    for(size_t byte = 0; byte < data.size(); byte++) {
-        if (byte % block_size == 0) {
-            state = iv;
-            *reinterpret_cast<uint64_t*>(state.data()) ^= counter++;
-            encryption->EncryptBlock(state.data());
-        }
-        data[byte] ^= state[byte % block_size];
-    }
+size_t BlockStreamEncryption::DecryptCBC(const uint8_t *in, size_t length, uint8_t *out) const {
+    uint64_t block_size = encryption->GetBlockBytes();
+    assert(length >= block_size + sizeof(uint64_t) && (length - sizeof(uint64_t)) % block_size == 0);
+    uint64_t origin_size;
+    std::memcpy(&origin_size, in + length - sizeof(uint64_t), sizeof(uint64_t));
+    assert(origin_size <= length - sizeof(uint64_t) - block_size);
+
+    Context context(*this, Mode::CBC, false);
+    context.Init(in);
+    context.Update(in + block_size, out, length - sizeof(uint64_t) - block_size);
+    return origin_size;
+}
 
-    data.insert(data.end(), iv.begin(), iv.end());
+size_t BlockStreamEncryption::EncryptStream(const uint8_t *in, size_t length, uint8_t *out, Mode mode) const {
+    uint64_t block_size = encryption->GetBlockBytes();
+    uint8_t iv[BlockEncryption::MAX_BLOCK_BYTES];
+    GenerateIV(iv, block_size);
+    Context context(*this, mode, true);
+    context.Init(iv);
+    context.Update(in, out, length);
+    std::copy(iv, iv + block_size, out + length);
+    return length + block_size;
 }
 
-void BlockStreamEncryption::DecryptCTR(std::vector<uint8_t> &data) const {
+size_t BlockStreamEncryption::DecryptStream(const uint8_t *in, size_t length, uint8_t *out, Mode mode) const {
     uint64_t block_size = encryption->GetBlockBytes();
-    uint64_t counter = 0;
-    auto iv = std::vector<uint8_t>(data.end()-block_size, data.end());
-    data.erase(data.end()-block_size, data.end());
-    auto state = iv;
-    assert(block_size >= sizeof(uint64_t));
+    assert(length >= block_size);
+    uint64_t size = length - block_size;
+    Context context(*this, mode, false);
+    context.Init(in + size);
+    context.Update(in, out, size);
+    return size;
+}
 
-    for(size_t byte = 0; byte < data.size(); byte++) {
-        if (byte % block_size == 0) {
-            state = iv;
-            *reinterpret_cast<uint64_t*>(state.data()) ^= counter++;
-            encryption->EncryptBlock(state.data());
+void BlockStreamEncryption::DecryptCBCBlocks(uint8_t *blocks, uint64_t n, const uint8_t *iv) const {
+    // Plaintext j is D(C_j) ^ C_{j-1}, so batches are independent once the ciphertext block
+    // preceding each batch is saved, before other threads overwrite it
+    uint64_t block_size = encryption->GetBlockBytes();
+    const uint64_t BATCH_BLOCKS = 256;
+    uint64_t batches = (n + BATCH_BLOCKS - 1) / BATCH_BLOCKS;
+    std::vector<uint8_t> previous(batches * block_size);
+    for (uint64_t batch = 0; batch < batches; batch++) {
+        const uint8_t *block = batch ? blocks + (batch * BATCH_BLOCKS - 1) * block_size : iv;
+        std::copy(block, block + block_size, previous.data() + batch * block_size);
+    }
+
+#pragma omp parallel if (batches > 1)
+    {
+        std::vector<uint8_t> ciphertext(BATCH_BLOCKS * block_size);
+#pragma omp for
+        for (uint64_t batch = 0; batch < batches; batch++) {
+            uint64_t first = batch * BATCH_BLOCKS;
+            uint64_t count = std::min(BATCH_BLOCKS, n - first);
+            uint8_t *batch_blocks = blocks + first * block_size;
+            std::copy(batch_blocks, batch_blocks + count * block_size, ciphertext.data());
+            encryption->DecryptBlocks(batch_blocks, count);
+            XorBytes(batch_blocks, previous.data() + batch * block_size, block_size);
+            XorBytes(batch_blocks + block_size, ciphertext.data(), (count - 1) * block_size);
         }
-        data[byte] ^= state[byte % block_size];
     }
 }
 
-void BlockStreamEncryption::EncryptCFB(std::vector<uint8_t> &data) const {
+void BlockStreamEncryption::GenerateIV(uint8_t *iv, uint64_t bytes) const {
+    RandomBytes(iv, bytes);
+}
+
+std::vector<uint8_t> BlockStreamEncryption::DecryptRangeCTR(const std::vector<uint8_t> &data, uint64_t offset,
+                                                            uint64_t length) const {
     uint64_t block_size = encryption->GetBlockBytes();
-    assert(block_size >= 8);
-    uint64_t small_block_size = block_size / 2 - 2;
-    auto iv = GenerateIV(block_size);
+    assert(data.size() >= block_size);
+    uint64_t data_size = data.size() - block_size;
+    offset = std::min(offset, data_size);
+    length = std::min(length, data_size - offset);
+
+    std::vector<uint8_t> result(data.begin() + offset, data.begin() + offset + length);
+    ApplyCTR(result.data(), result.size(), data.data() + data_size, offset);
+    return result;
+}
 
-    auto state = iv;
-    uint64_t origin_size = data.size();
-    AlignData(data, small_block_size);
+void BlockStreamEncryption::FillCounters(uint8_t *blocks, const uint8_t *iv, uint64_t first, uint64_t n) const {
+    // The last 16 bytes of the block are a 128-bit big-endian counter, as in SP 800-38A
+    uint64_t block_size = encryption->GetBlockBytes();
+    uint64_t iv_high = LoadBigEndian64(iv + block_size - 16);
+    uint64_t iv_low = LoadBigEndian64(iv + block_size - 8);
+    for (uint64_t block = 0; block < n; block++) {
+        uint8_t *state = blocks + block * block_size;
+        uint64_t low = iv_low + first + block;
+        uint64_t high = iv_high + (low < iv_low);
+        std::copy(iv, iv + block_size - 16, state);
+        StoreBigEndian64(state + block_size - 16, high);
+        StoreBigEndian64(state + block_size - 8, low);
+    }
+}
 
-    for(size_t byte = 0; byte < data.size(); byte+=small_block_size) {
-        auto temp = state;
-        encryption->EncryptBlock(temp.data());
-        temp.erase(temp.begin(), temp.end() - small_block_size);
-        for(uint64_t i = 0; i < small_block_size; i++) {
-            data[byte + i] ^= temp[i];
+void BlockStreamEncryption::ApplyCTR(uint8_t *data, uint64_t length, const uint8_t *iv, uint64_t offset) const {
+    uint64_t block_size = encryption->GetBlockBytes();
+    assert(block_size >= 16);
+    // Positions below are relative to the start of the block containing offset
+    uint64_t first_block = offset / block_size;
+    uint64_t skip = offset % block_size;
+    uint64_t end = skip + length;
+    uint64_t blocks = (end + block_size - 1) / block_size;
+
+    // Every batch is independent, so threads generate keystream for their own counter ranges
+    const uint64_t BATCH_BLOCKS = 256;
+    uint64_t batches = (blocks + BATCH_BLOCKS - 1) / BATCH_BLOCKS;
+#pragma omp parallel if (batches > 1)
+    {
+        alignas(64) uint8_t keystream[BATCH_BLOCKS * BlockEncryption::MAX_BLOCK_BYTES];
+#pragma omp for
+        for (uint64_t batch = 0; batch < batches; batch++) {
+            uint64_t first = batch * BATCH_BLOCKS;
+            uint64_t count = std::min(BATCH_BLOCKS, blocks - first);
+            FillCounters(keystream, iv, first_block + first, count);
+            encryption->EncryptBlocks(keystream, count);
+
+            uint64_t begin = std::max(first * block_size, skip);
+            uint64_t stop = std::min((first + count) * block_size, end);
+            XorBytes(data + begin - skip, keystream + begin - first * block_size, stop - begin);
         }
-        state.erase(state.begin(), state.begin() + small_block_size);
-        state.insert(state.end(), data.begin() + byte, data.begin() + byte + small_block_size);
     }
+}
 
-    PushUint64(data, origin_size);
-    data.insert(data.end(), iv.begin(), iv.end());
+BlockEncryption::FileStats BlockStreamEncryption::EncryptFileCTR(const std::string &source,
+                                                                 const std::string &destination) const {
+    return ProcessFileCTR(source, destination, true);
 }
 
-void BlockStreamEncryption::DecryptCFB(std::vector<uint8_t> &data) const {
-    uint64_t block_size = encryption->GetBlockBytes();
-    assert(block_size >= 8);
-    uint64_t small_block_size = block_size / 2 - 2;
-    auto iv = std::vector<uint8_t>(data.end()-block_size, data.end());
-    data.erase(data.end()-block_size, data.end());
-    uint64_t origin_size = PopUint64(data);
+BlockEncryption::FileStats BlockStreamEncryption::DecryptFileCTR(const std::string &source,
+                                                                 const std::string &destination) const {
+    return ProcessFileCTR(source, destination, false);
+}
+
+bool BlockStreamEncryption::ReadHeaderCTR(const std::string &source, BlockEncryption::FileHeader &header) const {
+    if (!BlockEncryption::ReadFileHeader(source, header) || header.cipher_id != encryption->GetCipherId() ||
+        header.mode != static_cast<uint16_t>(Mode::CTR) || header.iv_bytes != encryption->GetBlockBytes()) {
+        return false;
+    }
+    std::ifstream in(source.c_str(), std::ios_base::binary | std::ios_base::ate);
+    return static_cast<uint64_t>(in.tellg()) >= sizeof(BlockEncryption::FileHeader) + header.length;
+}
 
-    auto state = iv;
-    AlignData(data, small_block_size);
+BlockEncryption::FileStats BlockStreamEncryption::ProcessFileCTR(const std::string &source,
+                                                                 const std::string &destination,
+                                                                 bool encrypt) const {
+    auto start = std::chrono::steady_clock::now();
+    BlockEncryption::FileStats stats;
+    BlockEncryption::FileHeader header{};
+    std::ifstream in(source.c_str(), std::ios_base::binary);
+    if (!in) {
+        return stats;
+    }
 
-    for(size_t byte = 0; byte < data.size(); byte+=small_block_size) {
-        auto temp = state;
-        auto data_copy = std::vector<uint8_t>(data.begin() + byte, data.begin() + byte + small_block_size);
-        encryption->EncryptBlock(temp.data());
-        temp.erase(temp.begin(), temp.end() - small_block_size);
-        for(uint64_t i = 0; i < small_block_size; i++) {
-            data[byte + i] ^= temp[i];
-        }
-        state.erase(state.begin(), state.begin() + small_block_size);
-        state.insert(state.end(), data_copy.begin(), data_copy.end());
+    if (encrypt) {
+        in.seekg(0, std::ios::end);
+        header = encryption->CreateFileHeader(in.tellg(), BlockEncryption::DEFAULT_CHUNK_BYTES);
+        in.seekg(0, std::ios::beg);
+        header.mode = static_cast<uint16_t>(Mode::CTR);
+        header.iv_bytes = encryption->GetBlockBytes();
+        GenerateIV(header.iv, header.iv_bytes);
+    } else if (ReadHeaderCTR(source, header)) {
+        in.seekg(sizeof(BlockEncryption::FileHeader), std::ios::beg);
+    } else {
+        return stats;
     }
 
-    data.resize(origin_size);
+    std::ofstream out(destination.c_str(), std::ios_base::binary);
+    if (encrypt) {
+        out.write(reinterpret_cast<const char *>(&header), sizeof(BlockEncryption::FileHeader));
+    }
+    std::vector<uint8_t> buffer(header.chunk_bytes);
+    for (uint64_t offset = 0; offset < header.length && in && out; offset += buffer.size()) {
+        uint64_t bytes = std::min<uint64_t>(buffer.size(), header.length - offset);
+        in.read(reinterpret_cast<char *>(buffer.data()), bytes);
+        ApplyCTR(buffer.data(), bytes, header.iv, offset);
+        out.write(reinterpret_cast<const char *>(buffer.data()), bytes);
+    }
+    out.close();
+
+    stats.success = in && out;
+    stats.bytes = header.length;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
 }
 
+bool BlockStreamEncryption::DecryptFileRangeCTR(const std::string &source, uint64_t offset, uint64_t length,
+                                                std::vector<uint8_t> &result) const {
+    BlockEncryption::FileHeader header{};
+    if (!ReadHeaderCTR(source, header)) {
+        return false;
+    }
+    offset = std::min(offset, header.length);
+    length = std::min(length, header.length - offset);
+
+    std::ifstream in(source.c_str(), std::ios_base::binary);
+    in.seekg(sizeof(BlockEncryption::FileHeader) + offset, std::ios::beg);
+    result.resize(length);
+    in.read(reinterpret_cast<char *>(result.data()), length);
+    ApplyCTR(result.data(), length, header.iv, offset);
+    return static_cast<bool>(in);
+}
 
+void BlockStreamEncryption::DecryptCFBSegments(uint8_t *data, uint64_t length, const uint8_t *iv,
+                                               uint64_t segment_size) const {
+    // The shift register of segment j is bytes [j * segment_size, j * segment_size + block_size) of iv || ciphertext,
+    // so every register is known up front and all of them are encrypted in parallel batches
+    uint64_t block_size = encryption->GetBlockBytes();
+    assert(segment_size > 0 && segment_size <= block_size);
+    uint64_t segments = (length + segment_size - 1) / segment_size;
+    auto stream_byte = [&](uint64_t position) {
+        return position < block_size ? iv[position] : data[position - block_size];
+    };
+    const uint64_t BATCH_SEGMENTS = 4096 / segment_size;
+    uint64_t batches = (segments + BATCH_SEGMENTS - 1) / BATCH_SEGMENTS;
+    std::vector<uint8_t> registers(batches * block_size);
+    for (uint64_t batch = 0; batch < batches; batch++) {
+        for (uint64_t i = 0; i < block_size; i++) {
+            registers[batch * block_size + i] = stream_byte(batch * BATCH_SEGMENTS * segment_size + i);
+        }
+    }
 
+#pragma omp parallel if (batches > 1)
+    {
+        // stream holds iv || ciphertext from the first register of the batch on
+        std::vector<uint8_t> stream(block_size + BATCH_SEGMENTS * segment_size);
+        std::vector<uint8_t> keystream(BATCH_SEGMENTS * block_size);
+#pragma omp for
+        for (uint64_t batch = 0; batch < batches; batch++) {
+            uint64_t first = batch * BATCH_SEGMENTS;
+            uint64_t count = std::min(BATCH_SEGMENTS, segments - first);
+            uint64_t offset = first * segment_size;
+            uint64_t bytes = std::min(count * segment_size, length - offset);
+            std::copy(registers.data() + batch * block_size, registers.data() + (batch + 1) * block_size,
+                      stream.data());
+            std::copy(data + offset, data + offset + bytes, stream.data() + block_size);
+            for (uint64_t i = 0; i < count; i++) {
+                const uint8_t *shift_register = stream.data() + i * segment_size;
+                std::copy(shift_register, shift_register + block_size, keystream.data() + i * block_size);
+            }
+            encryption->EncryptBlocks(keystream.data(), count);
+            if (segment_size == block_size) {
+                XorBytes(data + offset, keystream.data(), bytes);
+                continue;
+            }
+            for (uint64_t i = 0; i < count; i++) {
+                uint64_t segment_bytes = std::min(segment_size, bytes - i * segment_size);
+                XorBytes(data + offset + i * segment_size, keystream.data() + i * block_size, segment_bytes);
+            }
+        }
+    }
+}
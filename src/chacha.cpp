@@ -0,0 +1,107 @@
+#include <crypto330/stream/chacha.hpp>
+#include <crypto330/utils.hpp>
+#include <cassert>
+
+inline uint32_t ChaCha_Rotate(uint32_t a, uint32_t b) {
+    return (a << b) | (a >> (32 - b));
+}
+
+inline void ChaCha_QuarterRound(uint32_t &a, uint32_t &b, uint32_t &c, uint32_t &d) {
+    a += b;
+    d = ChaCha_Rotate(d ^ a, 16);
+    c += d;
+    b = ChaCha_Rotate(b ^ c, 12);
+    a += b;
+    d = ChaCha_Rotate(d ^ a, 8);
+    c += d;
+    b = ChaCha_Rotate(b ^ c, 7);
+}
+
+void ChaCha_Rounds(uint32_t *x) {
+    for (uint32_t i = 0; i < 10; i++) {
+        ChaCha_QuarterRound(x[0], x[4], x[8], x[12]);    // column 1
+        ChaCha_QuarterRound(x[1], x[5], x[9], x[13]);    // column 2
+        ChaCha_QuarterRound(x[2], x[6], x[10], x[14]);    // column 3
+        ChaCha_QuarterRound(x[3], x[7], x[11], x[15]);    // column 4
+        ChaCha_QuarterRound(x[0], x[5], x[10], x[15]);    // diagonal 1
+        ChaCha_QuarterRound(x[1], x[6], x[11], x[12]);    // diagonal 2
+        ChaCha_QuarterRound(x[2], x[7], x[8], x[13]);    // diagonal 3
+        ChaCha_QuarterRound(x[3], x[4], x[9], x[14]);    // diagonal 4
+    }
+}
+
+// "expand 32-byte k"
+void ChaCha_InitState(uint32_t *state, const uint8_t *key) {
+    state[0] = 0x61707865;
+    state[1] = 0x3320646e;
+    state[2] = 0x79622d32;
+    state[3] = 0x6b206574;
+    std::memcpy(state + 4, key, 32);
+}
+
+void HChaCha20(const uint8_t *key, const uint8_t *nonce, uint8_t *subkey) {
+    uint32_t x[16];
+    ChaCha_InitState(x, key);
+    std::memcpy(x + 12, nonce, 16);
+    ChaCha_Rounds(x);
+    std::memcpy(subkey, x, 16);
+    std::memcpy(subkey + 16, x + 12, 16);
+}
+
+ChaCha20::ChaCha20(const std::string &key, bool hex, const std::vector<uint8_t> &nonce, Engine engine)
+        : ChaCha20(hex ? HexStringToBytes(key) : StringToBytes(key), nonce, engine) {}
+
+ChaCha20::ChaCha20(const std::vector<uint8_t> &key, const std::vector<uint8_t> &nonce, Engine engine)
+        : KeystreamCipher(engine) {
+    assert(key.size() == KEY_BYTES);
+    assert(nonce.empty() || nonce.size() == NONCE_BYTES || nonce.size() == SHORT_NONCE_BYTES);
+    ChaCha_InitState(state, key.data());
+    wide_counter = nonce.size() == SHORT_NONCE_BYTES;
+    // The nonce fills the words after the counter
+    std::memcpy(state + 16 - nonce.size() / 4, nonce.data(), nonce.size());
+}
+
+void ChaCha20::GenerateBlocks(uint64_t counter, uint8_t *blocks, size_t n, Engine engine) const {
+    // A 32-bit counter must not run into the nonce
+    assert(wide_counter || counter + n <= 0x100000000ull);
+    size_t done = 0;
+    if (engine >= Engine::AVX512) {
+        done += ChaCha_BlocksAVX512(state, counter, wide_counter, blocks, n);
+    }
+    if (engine >= Engine::AVX2) {
+        done += ChaCha_BlocksAVX2(state, counter + done, wide_counter, blocks + done * BLOCK_BYTES, n - done);
+    }
+    if (engine >= Engine::SSE2) {
+        done += ChaCha_BlocksSSE2(state, counter + done, wide_counter, blocks + done * BLOCK_BYTES, n - done);
+    }
+    for (; done < n; done++) {
+        uint32_t x[16], input[16];
+        std::memcpy(input, state, sizeof(input));
+        input[12] = uint32_t(counter + done);
+        if (wide_counter) {
+            input[13] = uint32_t((counter + done) >> 32u);
+        }
+        std::memcpy(x, input, sizeof(x));
+        ChaCha_Rounds(x);
+        for (uint32_t i = 0; i < 16; i++) {
+            x[i] += input[i];
+        }
+        std::memcpy(blocks + done * BLOCK_BYTES, x, BLOCK_BYTES);
+    }
+}
+
+std::vector<uint8_t> XChaCha_Subkey(const std::string &key, bool hex, const std::vector<uint8_t> &nonce) {
+    std::vector<uint8_t> key_bytes = hex ? HexStringToBytes(key) : StringToBytes(key);
+    assert(key_bytes.size() == ChaCha20::KEY_BYTES && nonce.size() == XChaCha20::NONCE_BYTES);
+    std::vector<uint8_t> subkey(ChaCha20::KEY_BYTES);
+    HChaCha20(key_bytes.data(), nonce.data(), subkey.data());
+    return subkey;
+}
+
+std::vector<uint8_t> XChaCha_Nonce(const std::vector<uint8_t> &nonce) {
+    assert(nonce.size() == XChaCha20::NONCE_BYTES);
+    return std::vector<uint8_t>(nonce.begin() + 16, nonce.end());
+}
+
+XChaCha20::XChaCha20(const std::string &key, bool hex, const std::vector<uint8_t> &nonce, Engine engine)
+        : ChaCha20(XChaCha_Subkey(key, hex, nonce), XChaCha_Nonce(nonce), engine) {}
@@ -0,0 +1,256 @@
+#include <crypto330/stream/chacha.hpp>
+#include <crypto330/utils.hpp>
+
+#ifdef CRYPTO330_X86
+
+#include <immintrin.h>
+
+// Same lane layout as the Salsa kernels: word i of every block sits in x[i], one block per 32-bit lane.
+// Rotations by 16 and 8 are byte shuffles where the instruction set has them.
+
+__attribute__((target("sse2"), always_inline))
+inline __m128i ChaCha_Rotate128(__m128i x, int bits) {
+    return _mm_or_si128(_mm_slli_epi32(x, bits), _mm_srli_epi32(x, 32 - bits));
+}
+
+__attribute__((target("sse2"), always_inline))
+inline __m128i ChaCha_Rotate128_16(__m128i x) {
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xb1), 0xb1);
+}
+
+__attribute__((target("sse2"), always_inline))
+inline void ChaCha_QuarterRound128(__m128i &a, __m128i &b, __m128i &c, __m128i &d) {
+    a = _mm_add_epi32(a, b);
+    d = ChaCha_Rotate128_16(_mm_xor_si128(d, a));
+    c = _mm_add_epi32(c, d);
+    b = ChaCha_Rotate128(_mm_xor_si128(b, c), 12);
+    a = _mm_add_epi32(a, b);
+    d = ChaCha_Rotate128(_mm_xor_si128(d, a), 8);
+    c = _mm_add_epi32(c, d);
+    b = ChaCha_Rotate128(_mm_xor_si128(b, c), 7);
+}
+
+__attribute__((target("sse2")))
+size_t ChaCha_BlocksSSE2(const uint32_t *state, uint64_t counter, bool wide_counter, uint8_t *blocks, size_t n) {
+    size_t done = 0;
+    for (; done + 4 <= n; done += 4) {
+        __m128i input[16];
+        for (uint32_t i = 0; i < 16; i++) {
+            input[i] = _mm_set1_epi32(state[i]);
+        }
+        uint32_t low[4], high[4];
+        for (uint32_t j = 0; j < 4; j++) {
+            low[j] = uint32_t(counter + done + j);
+            high[j] = uint32_t((counter + done + j) >> 32u);
+        }
+        input[12] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(low));
+        if (wide_counter) {
+            input[13] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(high));
+        }
+
+        __m128i x[16];
+        for (uint32_t i = 0; i < 16; i++) {
+            x[i] = input[i];
+        }
+        for (uint32_t round = 0; round < 10; round++) {
+            ChaCha_QuarterRound128(x[0], x[4], x[8], x[12]);
+            ChaCha_QuarterRound128(x[1], x[5], x[9], x[13]);
+            ChaCha_QuarterRound128(x[2], x[6], x[10], x[14]);
+            ChaCha_QuarterRound128(x[3], x[7], x[11], x[15]);
+            ChaCha_QuarterRound128(x[0], x[5], x[10], x[15]);
+            ChaCha_QuarterRound128(x[1], x[6], x[11], x[12]);
+            ChaCha_QuarterRound128(x[2], x[7], x[8], x[13]);
+            ChaCha_QuarterRound128(x[3], x[4], x[9], x[14]);
+        }
+
+        uint8_t *out = blocks + done * 64;
+        for (uint32_t group = 0; group < 4; group++) {
+            __m128i a = _mm_add_epi32(x[group * 4], input[group * 4]);
+            __m128i b = _mm_add_epi32(x[group * 4 + 1], input[group * 4 + 1]);
+            __m128i c = _mm_add_epi32(x[group * 4 + 2], input[group * 4 + 2]);
+            __m128i d = _mm_add_epi32(x[group * 4 + 3], input[group * 4 + 3]);
+            __m128i ab_low = _mm_unpacklo_epi32(a, b), ab_high = _mm_unpackhi_epi32(a, b);
+            __m128i cd_low = _mm_unpacklo_epi32(c, d), cd_high = _mm_unpackhi_epi32(c, d);
+            uint8_t *words = out + group * 16;
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(words), _mm_unpacklo_epi64(ab_low, cd_low));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(words + 64), _mm_unpackhi_epi64(ab_low, cd_low));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(words + 128), _mm_unpacklo_epi64(ab_high, cd_high));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(words + 192), _mm_unpackhi_epi64(ab_high, cd_high));
+        }
+    }
+    return done;
+}
+
+__attribute__((target("avx2"), always_inline))
+inline __m256i ChaCha_Rotate256(__m256i x, int bits) {
+    return _mm256_or_si256(_mm256_slli_epi32(x, bits), _mm256_srli_epi32(x, 32 - bits));
+}
+
+__attribute__((target("avx2"), always_inline))
+inline void ChaCha_QuarterRound256(__m256i &a, __m256i &b, __m256i &c, __m256i &d,
+                                   __m256i rotate16, __m256i rotate8) {
+    a = _mm256_add_epi32(a, b);
+    d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rotate16);
+    c = _mm256_add_epi32(c, d);
+    b = ChaCha_Rotate256(_mm256_xor_si256(b, c), 12);
+    a = _mm256_add_epi32(a, b);
+    d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rotate8);
+    c = _mm256_add_epi32(c, d);
+    b = ChaCha_Rotate256(_mm256_xor_si256(b, c), 7);
+}
+
+__attribute__((target("avx2")))
+size_t ChaCha_BlocksAVX2(const uint32_t *state, uint64_t counter, bool wide_counter, uint8_t *blocks, size_t n) {
+    const __m256i rotate16 = _mm256_set_epi8(13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2,
+                                             13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2);
+    const __m256i rotate8 = _mm256_set_epi8(14, 13, 12, 15, 10, 9, 8, 11, 6, 5, 4, 7, 2, 1, 0, 3,
+                                            14, 13, 12, 15, 10, 9, 8, 11, 6, 5, 4, 7, 2, 1, 0, 3);
+    size_t done = 0;
+    for (; done + 8 <= n; done += 8) {
+        __m256i input[16];
+        for (uint32_t i = 0; i < 16; i++) {
+            input[i] = _mm256_set1_epi32(state[i]);
+        }
+        uint32_t low[8], high[8];
+        for (uint32_t j = 0; j < 8; j++) {
+            low[j] = uint32_t(counter + done + j);
+            high[j] = uint32_t((counter + done + j) >> 32u);
+        }
+        input[12] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(low));
+        if (wide_counter) {
+            input[13] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(high));
+        }
+
+        __m256i x[16];
+        for (uint32_t i = 0; i < 16; i++) {
+            x[i] = input[i];
+        }
+        for (uint32_t round = 0; round < 10; round++) {
+            ChaCha_QuarterRound256(x[0], x[4], x[8], x[12], rotate16, rotate8);
+            ChaCha_QuarterRound256(x[1], x[5], x[9], x[13], rotate16, rotate8);
+            ChaCha_QuarterRound256(x[2], x[6], x[10], x[14], rotate16, rotate8);
+            ChaCha_QuarterRound256(x[3], x[7], x[11], x[15], rotate16, rotate8);
+            ChaCha_QuarterRound256(x[0], x[5], x[10], x[15], rotate16, rotate8);
+            ChaCha_QuarterRound256(x[1], x[6], x[11], x[12], rotate16, rotate8);
+            ChaCha_QuarterRound256(x[2], x[7], x[8], x[13], rotate16, rotate8);
+            ChaCha_QuarterRound256(x[3], x[4], x[9], x[14], rotate16, rotate8);
+        }
+
+        // Lanes 0-3 are transposed in the low halves and lanes 4-7 in the high halves
+        uint8_t *out = blocks + done * 64;
+        for (uint32_t group = 0; group < 4; group++) {
+            __m256i a = _mm256_add_epi32(x[group * 4], input[group * 4]);
+            __m256i b = _mm256_add_epi32(x[group * 4 + 1], input[group * 4 + 1]);
+            __m256i c = _mm256_add_epi32(x[group * 4 + 2], input[group * 4 + 2]);
+            __m256i d = _mm256_add_epi32(x[group * 4 + 3], input[group * 4 + 3]);
+            __m256i ab_low = _mm256_unpacklo_epi32(a, b), ab_high = _mm256_unpackhi_epi32(a, b);
+            __m256i cd_low = _mm256_unpacklo_epi32(c, d), cd_high = _mm256_unpackhi_epi32(c, d);
+            __m256i words[4] = {_mm256_unpacklo_epi64(ab_low, cd_low), _mm256_unpackhi_epi64(ab_low, cd_low),
+                                _mm256_unpacklo_epi64(ab_high, cd_high), _mm256_unpackhi_epi64(ab_high, cd_high)};
+            for (uint32_t j = 0; j < 4; j++) {
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + j * 64 + group * 16),
+                                 _mm256_castsi256_si128(words[j]));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + (j + 4) * 64 + group * 16),
+                                 _mm256_extracti128_si256(words[j], 1));
+            }
+        }
+    }
+    return done;
+}
+
+// AVX-512 rotates, unpacks and extracts use the maskz forms with a full mask. They encode the same
+// instructions, while GCC 12's unmasked intrinsics start from an undefined vector that it then reports
+// under -Wmaybe-uninitialized.
+__attribute__((target("avx512f"), always_inline))
+inline void ChaCha_QuarterRound512(__m512i &a, __m512i &b, __m512i &c, __m512i &d) {
+    a = _mm512_add_epi32(a, b);
+    d = _mm512_maskz_rol_epi32(0xffff, _mm512_xor_si512(d, a), 16);
+    c = _mm512_add_epi32(c, d);
+    b = _mm512_maskz_rol_epi32(0xffff, _mm512_xor_si512(b, c), 12);
+    a = _mm512_add_epi32(a, b);
+    d = _mm512_maskz_rol_epi32(0xffff, _mm512_xor_si512(d, a), 8);
+    c = _mm512_add_epi32(c, d);
+    b = _mm512_maskz_rol_epi32(0xffff, _mm512_xor_si512(b, c), 7);
+}
+
+__attribute__((target("avx512f")))
+size_t ChaCha_BlocksAVX512(const uint32_t *state, uint64_t counter, bool wide_counter, uint8_t *blocks, size_t n) {
+    size_t done = 0;
+    for (; done + 16 <= n; done += 16) {
+        __m512i input[16];
+        for (uint32_t i = 0; i < 16; i++) {
+            input[i] = _mm512_set1_epi32(state[i]);
+        }
+        uint32_t low[16], high[16];
+        for (uint32_t j = 0; j < 16; j++) {
+            low[j] = uint32_t(counter + done + j);
+            high[j] = uint32_t((counter + done + j) >> 32u);
+        }
+        input[12] = _mm512_loadu_si512(low);
+        if (wide_counter) {
+            input[13] = _mm512_loadu_si512(high);
+        }
+
+        __m512i x[16];
+        for (uint32_t i = 0; i < 16; i++) {
+            x[i] = input[i];
+        }
+        for (uint32_t round = 0; round < 10; round++) {
+            ChaCha_QuarterRound512(x[0], x[4], x[8], x[12]);
+            ChaCha_QuarterRound512(x[1], x[5], x[9], x[13]);
+            ChaCha_QuarterRound512(x[2], x[6], x[10], x[14]);
+            ChaCha_QuarterRound512(x[3], x[7], x[11], x[15]);
+            ChaCha_QuarterRound512(x[0], x[5], x[10], x[15]);
+            ChaCha_QuarterRound512(x[1], x[6], x[11], x[12]);
+            ChaCha_QuarterRound512(x[2], x[7], x[8], x[13]);
+            ChaCha_QuarterRound512(x[3], x[4], x[9], x[14]);
+        }
+
+        // Every 128-bit quarter q is transposed on its own and holds lanes 4q to 4q+3
+        uint8_t *out = blocks + done * 64;
+        for (uint32_t group = 0; group < 4; group++) {
+            __m512i a = _mm512_add_epi32(x[group * 4], input[group * 4]);
+            __m512i b = _mm512_add_epi32(x[group * 4 + 1], input[group * 4 + 1]);
+            __m512i c = _mm512_add_epi32(x[group * 4 + 2], input[group * 4 + 2]);
+            __m512i d = _mm512_add_epi32(x[group * 4 + 3], input[group * 4 + 3]);
+            __m512i ab_low = _mm512_maskz_unpacklo_epi32(0xffff, a, b);
+            __m512i ab_high = _mm512_maskz_unpackhi_epi32(0xffff, a, b);
+            __m512i cd_low = _mm512_maskz_unpacklo_epi32(0xffff, c, d);
+            __m512i cd_high = _mm512_maskz_unpackhi_epi32(0xffff, c, d);
+            __m512i words[4] = {_mm512_maskz_unpacklo_epi64(0xff, ab_low, cd_low),
+                                _mm512_maskz_unpackhi_epi64(0xff, ab_low, cd_low),
+                                _mm512_maskz_unpacklo_epi64(0xff, ab_high, cd_high),
+                                _mm512_maskz_unpackhi_epi64(0xff, ab_high, cd_high)};
+            for (uint32_t j = 0; j < 4; j++) {
+                uint8_t *block = out + j * 64 + group * 16;
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(block),
+                                 _mm512_maskz_extracti32x4_epi32(0xf, words[j], 0));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(block + 256),
+                                 _mm512_maskz_extracti32x4_epi32(0xf, words[j], 1));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(block + 512),
+                                 _mm512_maskz_extracti32x4_epi32(0xf, words[j], 2));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(block + 768),
+                                 _mm512_maskz_extracti32x4_epi32(0xf, words[j], 3));
+            }
+        }
+    }
+    return done;
+}
+
+#else
+
+// Only the portable engine is available on other architectures
+
+size_t ChaCha_BlocksSSE2(const uint32_t *state, uint64_t counter, bool wide_counter, uint8_t *blocks, size_t n) {
+    return 0;
+}
+
+size_t ChaCha_BlocksAVX2(const uint32_t *state, uint64_t counter, bool wide_counter, uint8_t *blocks, size_t n) {
+    return 0;
+}
+
+size_t ChaCha_BlocksAVX512(const uint32_t *state, uint64_t counter, bool wide_counter, uint8_t *blocks, size_t n) {
+    return 0;
+}
+
+#endif
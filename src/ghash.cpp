@@ -0,0 +1,85 @@
+#include <crypto330/stream/ghash.hpp>
+#include <crypto330/utils.hpp>
+#include <algorithm>
+
+// Reduction of the four bits shifted out of the low end, x^128 = x^7 + x^2 + x + 1 in GCM bit order
+const uint64_t GHASH_LAST4[16] = {
+        0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+        0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0
+};
+
+GHash::GHash(const uint8_t *h) : GHash(h, GetCpuFeatures().pclmul && GetCpuFeatures().ssse3) {}
+
+GHash::GHash(const uint8_t *h, bool clmul) : clmul(clmul) {
+    if (clmul) {
+        GHash_InitClmul(h, powers);
+        return;
+    }
+    // table[8] = H, table[4] = H * x, table[2] = H * x^2, table[1] = H * x^3, the rest are sums
+    uint64_t high = LoadBigEndian64(h);
+    uint64_t low = LoadBigEndian64(h + 8);
+    table_high[8] = high;
+    table_low[8] = low;
+    for (uint32_t i = 4; i > 0; i >>= 1u) {
+        uint64_t reduce = (low & 1u) * 0xe100000000000000ull;
+        low = (high << 63u) | (low >> 1u);
+        high = (high >> 1u) ^ reduce;
+        table_high[i] = high;
+        table_low[i] = low;
+    }
+    for (uint32_t i = 2; i <= 8; i *= 2) {
+        for (uint32_t j = 1; j < i; j++) {
+            table_high[i + j] = table_high[i] ^ table_high[j];
+            table_low[i + j] = table_low[i] ^ table_low[j];
+        }
+    }
+}
+
+void GHash::MultiplyTable(uint8_t *x) const {
+    // Horner's rule over the nibbles of x, from the last one, multiplying by x^4 between them
+    uint64_t high = table_high[x[15] & 0xfu];
+    uint64_t low = table_low[x[15] & 0xfu];
+    auto shift_add = [&](uint32_t nibble) {
+        uint64_t rem = low & 0xfu;
+        low = (high << 60u) | (low >> 4u);
+        high = (high >> 4u) ^ (GHASH_LAST4[rem] << 48u);
+        high ^= table_high[nibble];
+        low ^= table_low[nibble];
+    };
+    shift_add(x[15] >> 4u);
+    for (int32_t i = 14; i >= 0; i--) {
+        shift_add(x[i] & 0xfu);
+        shift_add(x[i] >> 4u);
+    }
+    StoreBigEndian64(x, high);
+    StoreBigEndian64(x + 8, low);
+}
+
+void GHash::UpdateTable(const uint8_t *blocks, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        XorBytes(y, blocks + i * 16, 16);
+        MultiplyTable(y);
+    }
+}
+
+void GHash::Update(const uint8_t *data, size_t length) {
+    size_t blocks = length / 16;
+    if (clmul) {
+        GHash_UpdateClmul(y, powers, data, blocks);
+    } else {
+        UpdateTable(data, blocks);
+    }
+    if (length % 16 != 0) {
+        uint8_t last[16]{};
+        std::copy(data + blocks * 16, data + length, last);
+        Update(last, 16);
+    }
+}
+
+void GHash::Final(uint64_t aad_length, uint64_t length, uint8_t *digest) {
+    uint8_t lengths[16];
+    StoreBigEndian64(lengths, aad_length * 8);
+    StoreBigEndian64(lengths + 8, length * 8);
+    Update(lengths, 16);
+    std::copy(y, y + 16, digest);
+}
@@ -0,0 +1,93 @@
+#include <crypto330/stream/ghash.hpp>
+#include <crypto330/utils.hpp>
+
+#ifdef CRYPTO330_X86
+
+#include <immintrin.h>
+
+// Operands are byte-reversed so that the bit-reflected GCM field maps onto PCLMULQDQ,
+// the 256-bit product is shifted left by one and reduced modulo x^128 + x^7 + x^2 + x + 1.
+
+__attribute__((target("pclmul,ssse3"), always_inline))
+inline __m128i GHash_ByteReverse(__m128i value) {
+    return _mm_shuffle_epi8(value, _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+}
+
+// Accumulates the unreduced product a * b into low and high
+__attribute__((target("pclmul,ssse3"), always_inline))
+inline void GHash_Multiply(__m128i a, __m128i b, __m128i &low, __m128i &high) {
+    __m128i middle = _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10), _mm_clmulepi64_si128(a, b, 0x01));
+    low = _mm_xor_si128(low, _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x00), _mm_slli_si128(middle, 8)));
+    high = _mm_xor_si128(high, _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x11), _mm_srli_si128(middle, 8)));
+}
+
+__attribute__((target("pclmul,ssse3"), always_inline))
+inline __m128i GHash_Reduce(__m128i low, __m128i high) {
+    // Shift the 256-bit product left by one bit
+    __m128i low_carry = _mm_srli_epi32(low, 31);
+    __m128i high_carry = _mm_srli_epi32(high, 31);
+    low = _mm_slli_epi32(low, 1);
+    high = _mm_slli_epi32(high, 1);
+    __m128i cross = _mm_srli_si128(low_carry, 12);
+    high_carry = _mm_slli_si128(high_carry, 4);
+    low_carry = _mm_slli_si128(low_carry, 4);
+    low = _mm_or_si128(low, low_carry);
+    high = _mm_or_si128(_mm_or_si128(high, high_carry), cross);
+
+    // Fold the low half into the high half in two phases
+    __m128i fold = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(low, 31), _mm_slli_epi32(low, 30)),
+                                 _mm_slli_epi32(low, 25));
+    __m128i fold_high = _mm_srli_si128(fold, 4);
+    low = _mm_xor_si128(low, _mm_slli_si128(fold, 12));
+    __m128i result = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi32(low, 1), _mm_srli_epi32(low, 2)),
+                                   _mm_srli_epi32(low, 7));
+    result = _mm_xor_si128(_mm_xor_si128(result, fold_high), low);
+    return _mm_xor_si128(high, result);
+}
+
+__attribute__((target("pclmul,ssse3")))
+void GHash_InitClmul(const uint8_t *h, uint8_t powers[4][16]) {
+    __m128i h1 = GHash_ByteReverse(_mm_loadu_si128(reinterpret_cast<const __m128i *>(h)));
+    __m128i power = h1;
+    for (uint32_t i = 0; i < 4; i++) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(powers[i]), power);
+        __m128i low = _mm_setzero_si128(), high = _mm_setzero_si128();
+        GHash_Multiply(power, h1, low, high);
+        power = GHash_Reduce(low, high);
+    }
+}
+
+__attribute__((target("pclmul,ssse3")))
+void GHash_UpdateClmul(uint8_t *y_bytes, const uint8_t powers[4][16], const uint8_t *blocks, size_t n) {
+    auto load = [](const uint8_t *bytes) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes));
+    };
+    __m128i h[4] = {load(powers[0]), load(powers[1]), load(powers[2]), load(powers[3])};
+    __m128i y = GHash_ByteReverse(load(y_bytes));
+    size_t i = 0;
+    // (y ^ x0) * H^4 ^ x1 * H^3 ^ x2 * H^2 ^ x3 * H with a single reduction
+    for (; i + 4 <= n; i += 4) {
+        __m128i low = _mm_setzero_si128(), high = _mm_setzero_si128();
+        for (uint32_t lane = 0; lane < 4; lane++) {
+            __m128i x = GHash_ByteReverse(load(blocks + (i + lane) * 16));
+            GHash_Multiply(lane == 0 ? _mm_xor_si128(y, x) : x, h[3 - lane], low, high);
+        }
+        y = GHash_Reduce(low, high);
+    }
+    for (; i < n; i++) {
+        __m128i low = _mm_setzero_si128(), high = _mm_setzero_si128();
+        GHash_Multiply(_mm_xor_si128(y, GHash_ByteReverse(load(blocks + i * 16))), h[0], low, high);
+        y = GHash_Reduce(low, high);
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(y_bytes), GHash_ByteReverse(y));
+}
+
+#else
+
+// The table implementation is always used on other architectures
+
+void GHash_InitClmul(const uint8_t *h, uint8_t powers[4][16]) {}
+
+void GHash_UpdateClmul(uint8_t *y, const uint8_t powers[4][16], const uint8_t *blocks, size_t n) {}
+
+#endif
@@ -0,0 +1,21 @@
+#include <crypto330/hash/hash.hpp>
+#include <fstream>
+
+std::vector<uint8_t> HashFile(Hash &hash, const std::string &path) {
+    const size_t CHUNK_BYTES = 1024 * 1024;
+    std::ifstream in(path.c_str(), std::ios_base::binary);
+    if (!in) {
+        return {};
+    }
+    hash.Reset();
+    std::vector<uint8_t> buffer(CHUNK_BYTES);
+    while (in) {
+        in.read(reinterpret_cast<char *>(buffer.data()), buffer.size());
+        hash.Update(buffer.data(), in.gcount());
+    }
+    if (in.bad()) {
+        hash.Reset();
+        return {};
+    }
+    return hash.Final();
+}
@@ -0,0 +1,21 @@
+#include <crypto330/hash/hmac.hpp>
+
+std::vector<uint8_t> Hmac(const Hash &hash, const std::vector<uint8_t> &key, const std::vector<uint8_t> &message) {
+    uint64_t block_size = hash.GetBlockSize();
+    std::vector<uint8_t> block_key = key.size() > block_size ? hash.GetHash(key) : key;
+    block_key.resize(block_size, 0);
+
+    std::vector<uint8_t> inner(block_size + message.size());
+    for (uint64_t i = 0; i < block_size; i++) {
+        inner[i] = block_key[i] ^ 0x36u;
+    }
+    std::copy(message.begin(), message.end(), inner.begin() + block_size);
+    std::vector<uint8_t> inner_hash = hash.GetHash(inner);
+
+    std::vector<uint8_t> outer(block_size + inner_hash.size());
+    for (uint64_t i = 0; i < block_size; i++) {
+        outer[i] = block_key[i] ^ 0x5cu;
+    }
+    std::copy(inner_hash.begin(), inner_hash.end(), outer.begin() + block_size);
+    return hash.GetHash(outer);
+}
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <algorithm>
 #include "crypto330/hugeint/hugeint.hpp"
+#include "crypto330/random.hpp"
 
 const uint64_t DIGIT_SIZE = 32; // in bits
 const uint64_t BASE = 1ull << DIGIT_SIZE;
@@ -448,6 +449,21 @@ UHugeInt UHugeInt::Rand(const UHugeInt &min, const UHugeInt &max, std::mt19937_6
     return Rand(max - min, rng) + min;
 }
 
+UHugeInt UHugeInt::Rand(const UHugeInt &max) {
+    std::vector<uint32_t> words(max.digits.size() + 8);
+    RandomBytes(reinterpret_cast<uint8_t *>(words.data()), words.size() * sizeof(uint32_t));
+    UHugeInt r;
+    r.digits.clear();
+    for (uint32_t word : words) {
+        r.digits.push_back(word % (BASE - 1) + 1);
+    }
+    return r % (max + 1);
+}
+
+UHugeInt UHugeInt::Rand(const UHugeInt &min, const UHugeInt &max) {
+    return Rand(max - min) + min;
+}
+
 uint64_t UHugeInt::BitSize() const {
     uint64_t res = (digits.size() - 1) * DIGIT_SIZE;
     uint64_t x = GetTopDigit();
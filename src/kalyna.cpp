@@ -2,6 +2,7 @@
 #include <algorithm>
 #include <crypto330/utils.hpp>
 #include <cassert>
+#include <cstring>
 
 uint8_t gf8_lookup_kalyna[256][256];
 
@@ -191,6 +192,38 @@ const uint8_t KALYNA_MDS_MATRIX_INV[8][8] = {
         {0x95, 0x76, 0xA8, 0x2F, 0x49, 0xD7, 0xCA, 0xAD}
 };
 
+// kalyna_round_tables[row][x] is the MixColumns column produced by S-box output S_row(x) placed in row `row`,
+// kalyna_inv_round_tables the same for S^-1 and the inverse matrix. Columns are little-endian 64-bit words.
+uint64_t kalyna_round_tables[8][256];
+uint64_t kalyna_inv_round_tables[8][256];
+
+bool kalyna_round_tables_initialized = false;
+
+void Kalyna_InitRoundTables() {
+    if (kalyna_round_tables_initialized) {
+        return;
+    }
+    for (uint32_t row = 0; row < 8; row++) {
+        for (uint32_t x = 0; x < 256; x++) {
+            uint64_t column = 0;
+            uint64_t inv_column = 0;
+            for (uint32_t out_row = 0; out_row < 8; out_row++) {
+                uint8_t value = GF8_Mul(KALYNA_S_BOX[row & 3][x], KALYNA_MDS_MATRIX[out_row][row], 0x1d);
+                uint8_t inv_value = GF8_Mul(KALYNA_S_BOX_INV[row & 3][x], KALYNA_MDS_MATRIX_INV[out_row][row], 0x1d);
+                column |= uint64_t(value) << (out_row * 8);
+                inv_column |= uint64_t(inv_value) << (out_row * 8);
+            }
+            kalyna_round_tables[row][x] = column;
+            kalyna_inv_round_tables[row][x] = inv_column;
+        }
+    }
+    kalyna_round_tables_initialized = true;
+}
+
+inline uint8_t Kalyna_Byte(uint64_t word, uint64_t row) {
+    return word >> (row * 8);
+}
+
 void Kalyna::BuildKeyExpansion() {
     uint8_t k0[64]{};
     uint8_t k1[64]{};
@@ -264,6 +297,13 @@ void Kalyna::BuildKeyExpansion() {
             std::swap(((uint64_t *) key_rot)[i], ((uint64_t *) key_rot)[i + 1]);
         }
     }
+
+    for (uint64_t round = 1; round < rounds_num; round++) {
+        uint8_t inv_round_key[64];
+        CopyBlockTo(key_expansion[round], inv_round_key);
+        InvMixColumns(inv_round_key);
+        memcpy(inv_key_expansion[round], inv_round_key, block_words * 8);
+    }
 }
 
 void Kalyna::AddRoundKeyExpand(uint8_t *block, const uint8_t *round_key) const {
@@ -332,62 +372,153 @@ void Kalyna::MulMatrix(uint8_t *block, const uint8_t *matrix) const {
     CopyBlockTo(res, block);
 }
 
-void Kalyna::EncryptBlock(uint8_t *block) const {
-    AddRoundKeyExpand(block, key_expansion[0]);
-    for (uint64_t round = 1; round < rounds_num; round++) {
-        EncryptRound(block);
-        XorRoundKeyExpand(block, key_expansion[round]);
-    }
-    EncryptRound(block);
-    AddRoundKeyExpand(block, key_expansion[rounds_num]);
-}
+// Block cipher for one Kalyna::Type with all sizes known at compile time, so the column loops unroll
+// and the state stays in registers. Round keys are 8 words apart, like Kalyna::key_expansion.
+template<uint64_t BlockWords, uint64_t KeyWords, uint64_t Rounds>
+struct KalynaImpl {
+    static_assert(BlockWords == 2 || BlockWords == 4 || BlockWords == 8, "Unsupported block size");
+    static_assert(KeyWords == BlockWords || KeyWords == 2 * BlockWords, "Unsupported key size");
+    static_assert(Rounds == (KeyWords == 2 ? 10 : KeyWords == 4 ? 14 : 18), "Wrong number of rounds");
 
-void Kalyna::DecryptBlock(uint8_t *block) const {
-    SubRoundKey(block, rounds_num);
-    for (uint64_t round = rounds_num - 1; round > 0; --round) {
-        DecryptRound(block);
-        XorRoundKey(block, round);
+    // Enough blocks in flight to keep about eight independent columns per round
+    static constexpr size_t LANES = 8 / BlockWords;
+
+    // ShiftRows moves row r by r * BlockWords / 8 columns
+    static constexpr uint64_t Shift(uint64_t row) {
+        return row * BlockWords / 8;
     }
-    DecryptRound(block);
-    SubRoundKey(block, 0);
-}
 
-void Kalyna::DecryptRound(uint8_t *block) const {
-    InvMixColumns(block);
-    InvShiftRows(block);
-    InvSubBytes(block);
-}
+    // One encryption round (SubBytes, ShiftRows, MixColumns) as 8 lookups per output column
+    static inline void EncryptRound(const uint64_t *in, uint64_t *out) {
+#pragma GCC unroll 8
+        for (uint64_t col = 0; col < BlockWords; col++) {
+            uint64_t column = 0;
+#pragma GCC unroll 8
+            for (uint64_t row = 0; row < 8; row++) {
+                column ^= kalyna_round_tables[row][Kalyna_Byte(in[(col - Shift(row)) % BlockWords], row)];
+            }
+            out[col] = column;
+        }
+    }
 
-void Kalyna::AddRoundKey(uint8_t *block, uint64_t round) const {
-    AddRoundKeyExpand(block, key_expansion[round]);
-}
+    // InvShiftRows, InvSubBytes and InvMixColumns in one pass
+    static inline void DecryptRound(const uint64_t *in, uint64_t *out) {
+#pragma GCC unroll 8
+        for (uint64_t col = 0; col < BlockWords; col++) {
+            uint64_t column = 0;
+#pragma GCC unroll 8
+            for (uint64_t row = 0; row < 8; row++) {
+                column ^= kalyna_inv_round_tables[row][Kalyna_Byte(in[(col + Shift(row)) % BlockWords], row)];
+            }
+            out[col] = column;
+        }
+    }
 
-void Kalyna::XorRoundKey(uint8_t *block, uint64_t round) const {
-    XorRoundKeyExpand(block, key_expansion[round]);
-}
+    template<size_t Lanes>
+    static void Encrypt(uint8_t *blocks, const uint64_t *round_keys) {
+        uint64_t state[Lanes][BlockWords];
+        uint64_t temp[Lanes][BlockWords];
+        memcpy(state, blocks, sizeof(state));
+        for (size_t lane = 0; lane < Lanes; lane++) {
+            for (uint64_t i = 0; i < BlockWords; i++) {
+                state[lane][i] += round_keys[i];
+            }
+        }
+        for (uint64_t round = 1; round < Rounds; round++) {
+            const uint64_t *round_key = round_keys + round * 8;
+            for (size_t lane = 0; lane < Lanes; lane++) {
+                EncryptRound(state[lane], temp[lane]);
+                for (uint64_t i = 0; i < BlockWords; i++) {
+                    state[lane][i] = temp[lane][i] ^ round_key[i];
+                }
+            }
+        }
+        const uint64_t *last_key = round_keys + Rounds * 8;
+        for (size_t lane = 0; lane < Lanes; lane++) {
+            EncryptRound(state[lane], temp[lane]);
+            for (uint64_t i = 0; i < BlockWords; i++) {
+                state[lane][i] = temp[lane][i] + last_key[i];
+            }
+        }
+        memcpy(blocks, state, sizeof(state));
+    }
 
-void Kalyna::SubRoundKey(uint8_t *block, uint64_t round) const {
-    for (uint64_t i = 0; i < block_words; i++) {
-        ((uint64_t *) block)[i] -= ((uint64_t *) key_expansion[round])[i];
+    // Equivalent inverse cipher: the XOR with round key i is moved past InvMixColumns,
+    // so inv_round_keys[i] holds InvMixColumns(round key i)
+    template<size_t Lanes>
+    static void Decrypt(uint8_t *blocks, const uint64_t *round_keys, const uint64_t *inv_round_keys) {
+        uint64_t state[Lanes][BlockWords];
+        uint64_t temp[Lanes][BlockWords];
+        memcpy(temp, blocks, sizeof(temp));
+        const uint64_t *last_key = round_keys + Rounds * 8;
+        for (size_t lane = 0; lane < Lanes; lane++) {
+            for (uint64_t i = 0; i < BlockWords; i++) {
+                uint64_t word = temp[lane][i] - last_key[i];
+                // InvMixColumns alone: the inverse tables apply S^-1 first, so feed them S(x)
+                uint64_t column = 0;
+                for (uint64_t row = 0; row < 8; row++) {
+                    column ^= kalyna_inv_round_tables[row][KALYNA_S_BOX[row & 3][Kalyna_Byte(word, row)]];
+                }
+                state[lane][i] = column;
+            }
+        }
+        for (uint64_t round = Rounds - 1; round > 0; round--) {
+            const uint64_t *round_key = inv_round_keys + round * 8;
+            for (size_t lane = 0; lane < Lanes; lane++) {
+                DecryptRound(state[lane], temp[lane]);
+                for (uint64_t i = 0; i < BlockWords; i++) {
+                    state[lane][i] = temp[lane][i] ^ round_key[i];
+                }
+            }
+        }
+        for (size_t lane = 0; lane < Lanes; lane++) {
+            for (uint64_t col = 0; col < BlockWords; col++) {
+                uint64_t column = 0;
+                for (uint64_t row = 0; row < 8; row++) {
+                    uint8_t byte = Kalyna_Byte(state[lane][(col + Shift(row)) % BlockWords], row);
+                    column |= uint64_t(KALYNA_S_BOX_INV[row & 3][byte]) << (row * 8);
+                }
+                temp[lane][col] = column - round_keys[col];
+            }
+        }
+        memcpy(blocks, temp, sizeof(temp));
     }
-}
 
-void Kalyna::InvSubBytes(uint8_t *block) const {
-    for (uint64_t i = 0; i < block_words; i++) {
-        for (uint64_t j = 0; j < 8; j++) {
-            block[i * 8 + j] = KALYNA_S_BOX_INV[j & 3][block[i * 8 + j]];
+    static void EncryptBlocks(const uint64_t *round_keys, const uint64_t *, uint8_t *blocks, size_t n) {
+        size_t i = 0;
+        for (; i + LANES <= n; i += LANES) {
+            Encrypt<LANES>(blocks + i * BlockWords * 8, round_keys);
+        }
+        for (; i < n; i++) {
+            Encrypt<1>(blocks + i * BlockWords * 8, round_keys);
         }
     }
-}
 
-void Kalyna::InvShiftRows(uint8_t *block) const {
-    uint8_t block_copy[64];
-    CopyBlockTo(block, block_copy);
-    for (uint64_t row = 0; row < 8; row++) {
-        for (uint64_t col = 0; col < block_words; col++) {
-            block[col * 8 + row] = block_copy[((col + row * block_words / 8) % block_words) * 8 + row];
+    static void DecryptBlocks(const uint64_t *round_keys, const uint64_t *inv_round_keys, uint8_t *blocks, size_t n) {
+        size_t i = 0;
+        for (; i + LANES <= n; i += LANES) {
+            Decrypt<LANES>(blocks + i * BlockWords * 8, round_keys, inv_round_keys);
+        }
+        for (; i < n; i++) {
+            Decrypt<1>(blocks + i * BlockWords * 8, round_keys, inv_round_keys);
         }
     }
+};
+
+void Kalyna::EncryptBlock(uint8_t *block) const {
+    encrypt_blocks(reinterpret_cast<const uint64_t *>(key_expansion[0]), inv_key_expansion[0], block, 1);
+}
+
+void Kalyna::DecryptBlock(uint8_t *block) const {
+    decrypt_blocks(reinterpret_cast<const uint64_t *>(key_expansion[0]), inv_key_expansion[0], block, 1);
+}
+
+void Kalyna::EncryptBlocks(uint8_t *blocks, size_t n) const {
+    encrypt_blocks(reinterpret_cast<const uint64_t *>(key_expansion[0]), inv_key_expansion[0], blocks, n);
+}
+
+void Kalyna::DecryptBlocks(uint8_t *blocks, size_t n) const {
+    decrypt_blocks(reinterpret_cast<const uint64_t *>(key_expansion[0]), inv_key_expansion[0], blocks, n);
 }
 
 void Kalyna::InvMixColumns(uint8_t *block) const {
@@ -400,31 +531,43 @@ Kalyna::Kalyna(Type type, const std::string &key_str, bool hex) {
             block_words = 2;
             key_words = 2;
             rounds_num = 10;
+            encrypt_blocks = KalynaImpl<2, 2, 10>::EncryptBlocks;
+            decrypt_blocks = KalynaImpl<2, 2, 10>::DecryptBlocks;
             break;
         case Type::K256_128:
             block_words = 2;
             key_words = 4;
             rounds_num = 14;
+            encrypt_blocks = KalynaImpl<2, 4, 14>::EncryptBlocks;
+            decrypt_blocks = KalynaImpl<2, 4, 14>::DecryptBlocks;
             break;
         case Type::K256_256:
             block_words = 4;
             key_words = 4;
             rounds_num = 14;
+            encrypt_blocks = KalynaImpl<4, 4, 14>::EncryptBlocks;
+            decrypt_blocks = KalynaImpl<4, 4, 14>::DecryptBlocks;
             break;
         case Type::K512_256:
             block_words = 4;
             key_words = 8;
             rounds_num = 18;
+            encrypt_blocks = KalynaImpl<4, 8, 18>::EncryptBlocks;
+            decrypt_blocks = KalynaImpl<4, 8, 18>::DecryptBlocks;
             break;
         case Type::K512_512:
             block_words = 8;
             key_words = 8;
             rounds_num = 18;
+            encrypt_blocks = KalynaImpl<8, 8, 18>::EncryptBlocks;
+            decrypt_blocks = KalynaImpl<8, 8, 18>::DecryptBlocks;
             break;
     }
     block_bytes = block_words * 8;
+    cipher_id = 0x0200 | static_cast<uint16_t>(type);
 
     GF8_InitLookupKalyna();
+    Kalyna_InitRoundTables();
 
     std::vector<uint8_t> key_bytes;
     if (hex) {
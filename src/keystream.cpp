@@ -0,0 +1,77 @@
+#include <crypto330/stream/keystream.hpp>
+#include <crypto330/utils.hpp>
+#include <algorithm>
+#include <cassert>
+
+KeystreamCipher::KeystreamCipher(Engine engine) : engine(engine) {
+    const CpuFeatures &features = GetCpuFeatures();
+    if (this->engine == Engine::Auto) {
+        this->engine = features.avx512f ? Engine::AVX512 : features.avx2 ? Engine::AVX2
+                     : features.sse2 ? Engine::SSE2 : Engine::Portable;
+    }
+    assert(this->engine != Engine::SSE2 || features.sse2);
+    assert(this->engine != Engine::AVX2 || features.avx2);
+    assert(this->engine != Engine::AVX512 || features.avx512f);
+}
+
+void KeystreamCipher::Encrypt(std::vector<uint8_t> &data) const {
+    ProcessData(data.data(), data.data(), data.size(), 0);
+}
+
+void KeystreamCipher::Decrypt(std::vector<uint8_t> &data) const {
+    ProcessData(data.data(), data.data(), data.size(), 0);
+}
+
+void KeystreamCipher::Encrypt(const uint8_t *in, uint8_t *out, size_t length) const {
+    ProcessData(in, out, length, 0);
+}
+
+void KeystreamCipher::Decrypt(const uint8_t *in, uint8_t *out, size_t length) const {
+    ProcessData(in, out, length, 0);
+}
+
+void KeystreamCipher::Encrypt(const uint8_t *in, uint8_t *out, size_t length, uint64_t offset) const {
+    ProcessData(in, out, length, offset);
+}
+
+void KeystreamCipher::Decrypt(const uint8_t *in, uint8_t *out, size_t length, uint64_t offset) const {
+    ProcessData(in, out, length, offset);
+}
+
+void KeystreamCipher::GenerateKeystream(uint64_t counter, uint8_t *blocks, size_t n) const {
+    GenerateBlocks(counter, blocks, n, engine);
+}
+
+KeystreamCipher::Engine KeystreamCipher::GetEngine() const {
+    return engine;
+}
+
+void KeystreamCipher::ProcessData(const uint8_t *in, uint8_t *out, size_t length, uint64_t offset) const {
+    // Positions below are relative to the start of the block containing offset
+    uint64_t first_block = offset / BLOCK_BYTES;
+    uint64_t skip = offset % BLOCK_BYTES;
+    uint64_t end = skip + length;
+    uint64_t blocks = (end + BLOCK_BYTES - 1) / BLOCK_BYTES;
+
+    // 16 KB of keystream per batch stays in L1 while it is xored into the data
+    const uint64_t BATCH_BLOCKS = 256;
+    uint64_t batches = (blocks + BATCH_BLOCKS - 1) / BATCH_BLOCKS;
+#pragma omp parallel if (batches > 1)
+    {
+        alignas(64) uint8_t keystream[BATCH_BLOCKS * BLOCK_BYTES];
+#pragma omp for
+        for (uint64_t batch = 0; batch < batches; batch++) {
+            uint64_t first = batch * BATCH_BLOCKS;
+            uint64_t count = std::min(BATCH_BLOCKS, blocks - first);
+            GenerateBlocks(first_block + first, keystream, count, engine);
+
+            uint64_t begin = std::max(first * BLOCK_BYTES, skip);
+            uint64_t stop = std::min((first + count) * BLOCK_BYTES, end);
+            uint8_t *destination = out + begin - skip;
+            if (in != out) {
+                std::copy(in + begin - skip, in + stop - skip, destination);
+            }
+            XorBytes(destination, keystream + begin - first * BLOCK_BYTES, stop - begin);
+        }
+    }
+}
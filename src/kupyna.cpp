@@ -118,6 +118,15 @@ Kupyna::Kupyna(Kupyna::Size size) : size(size) {
             break;
     }
     block_size = columns * rows;
+    Reset();
+}
+
+uint64_t Kupyna::GetBlockSize() const {
+    return block_size;
+}
+
+uint64_t Kupyna::GetDigestSize() const {
+    return hash_size;
 }
 
 
@@ -142,7 +151,7 @@ void Kupyna::ShiftBytes(uint8_t *block) const {
 
 
 void Kupyna::MixColumns(uint8_t *block) const {
-    uint8_t res[128];
+    uint8_t res[128] = {};
     for (uint64_t col = 0; col < columns; col++) {
         for (uint64_t row = 0; row < 8; row++) {
             for (uint64_t i = 0; i < 8; i++) {
@@ -174,45 +183,86 @@ void Kupyna::ProcessBlock(uint8_t *block, bool p_or_q) const {
     }
 }
 
-std::vector<uint8_t> Kupyna::GetHash(const std::vector<uint8_t> &data) const {
+void Kupyna::CompressBlock(uint8_t *state, const uint8_t *data) const {
+    uint8_t temp1[8 * 16];
+    uint8_t temp2[8 * 16];
+    for (uint64_t i = 0; i < block_size; ++i) {
+        temp1[i] = state[i] ^ data[i];
+        temp2[i] = data[i];
+    }
+    ProcessBlock(temp1, true);
+    ProcessBlock(temp2, false);
+    for (uint64_t i = 0; i < block_size; ++i) {
+        state[i] ^= temp1[i] ^ temp2[i];
+    }
+}
+
+std::vector<uint8_t> Kupyna::Finish(uint8_t *state, const uint8_t *rest_data, size_t rest, uint64_t length) const {
+    // 0x80, zeros and the 96-bit little-endian bit length
+    uint8_t tail[2 * 8 * 16] = {};
+    uint64_t tail_bytes = rest + 13 <= block_size ? block_size : 2 * block_size;
+    std::copy(rest_data, rest_data + rest, tail);
+    tail[rest] = 0x80u;
+    uint64_t bit_length = length * 8;
+    for (uint64_t i = 0; i < 8; i++) {
+        tail[tail_bytes - 12 + i] = bit_length >> i * 8;
+    }
+    for (uint64_t offset = 0; offset < tail_bytes; offset += block_size) {
+        CompressBlock(state, tail + offset);
+    }
+
+    uint8_t copy[8 * 16];
+    std::copy(state, state + block_size, copy);
+    ProcessBlock(copy, true);
+    for (uint64_t i = 0; i < block_size; ++i) {
+        state[i] ^= copy[i];
+    }
+    return std::vector<uint8_t>(state + block_size - hash_size, state + block_size);
+}
+
+std::vector<uint8_t> Kupyna::GetHash(const uint8_t *data, size_t length) const {
     uint8_t block[8 * 16];
     std::fill(block, block + block_size, 0);
     block[0] = block_size;
 
-    auto data_copy = data;
-
-    uint64_t bit_length = data_copy.size() * 8;
-    data_copy.push_back(0x80u);
-    while (data_copy.size() % block_size != block_size - 12) {
-        data_copy.push_back(0x00u);
-    }
-    for (uint64_t i = 0; i < 12; i++) {
-        if (i < sizeof(size_t)) {
-            data_copy.push_back(static_cast<char>(bit_length >> i * 8));
-        } else {
-            data_copy.push_back(static_cast<char>(0x00));
-        }
+    // Whole blocks are compressed in place, only the padded tail is copied
+    size_t full_blocks = length / block_size;
+    for (size_t i = 0; i < full_blocks; i++) {
+        CompressBlock(block, data + i * block_size);
     }
+    return Finish(block, data + full_blocks * block_size, length % block_size, length);
+}
 
-    uint8_t temp1[8 * 16];
-    uint8_t temp2[8 * 16];
-    for (uint64_t offset = 0; offset < data_copy.size(); offset += block_size) {
-        for (uint64_t i = 0; i < block_size; ++i) {
-            temp1[i] = block[i] ^ data_copy[offset + i];
-            temp2[i] = data_copy[offset + i];
-        }
-        ProcessBlock(temp1, true);
-        ProcessBlock(temp2, false);
-        for (uint64_t in_block_id = 0; in_block_id < block_size; ++in_block_id) {
-            block[in_block_id] ^= temp1[in_block_id] ^ temp2[in_block_id];
+void Kupyna::Update(const uint8_t *data, size_t length) {
+    stream_length += length;
+    if (buffered > 0) {
+        size_t take = std::min<size_t>(length, block_size - buffered);
+        std::copy(data, data + take, stream_buffer + buffered);
+        buffered += take;
+        data += take;
+        length -= take;
+        if (buffered < block_size) {
+            return;
         }
+        CompressBlock(stream_state, stream_buffer);
+        buffered = 0;
     }
-
-    uint8_t copy[8 * 16];
-    std::copy(block, block + block_size, copy);
-    ProcessBlock(copy, true);
-    for (auto i = 0; i < block_size; ++i) {
-        block[i] ^= copy[i];
+    for (; length >= block_size; data += block_size, length -= block_size) {
+        CompressBlock(stream_state, data);
     }
-    return std::vector<uint8_t>(block + block_size - hash_size, block + block_size);
+    std::copy(data, data + length, stream_buffer);
+    buffered = length;
+}
+
+std::vector<uint8_t> Kupyna::Final() {
+    std::vector<uint8_t> digest = Finish(stream_state, stream_buffer, buffered, stream_length);
+    Reset();
+    return digest;
+}
+
+void Kupyna::Reset() {
+    std::fill(stream_state, stream_state + block_size, 0);
+    stream_state[0] = block_size;
+    buffered = 0;
+    stream_length = 0;
 }
@@ -80,11 +80,8 @@ bool IsProbablePrime(const UHugeInt &number, uint64_t tests) {
         r++;
     }
 
-    std::mt19937_64 rng;
-    rng.seed(number.ToUint64());
-
     for (uint64_t test = 0; test < tests; test++) {
-        UHugeInt a = UHugeInt::Rand(2, number - 2, rng);
+        UHugeInt a = UHugeInt::Rand(2, number - 2);
         UHugeInt x = UHugeInt::PowMod(a, d, number);
         if (x == 1 || x == number - 1) {
             continue;
@@ -0,0 +1,160 @@
+#include <crypto330/random.hpp>
+#include <crypto330/block/aes.hpp>
+#include <crypto330/utils.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <mutex>
+#include <pthread.h>
+
+#if defined(__linux__)
+#include <sys/random.h>
+#endif
+
+// Key and counter taken from the generator output or the system
+const size_t SEED_BYTES = 48;
+
+// Bumped in the child after fork(), generators compare it instead of calling getpid() on every request
+std::atomic<uint64_t> fork_generation{0};
+
+void OnFork() {
+    fork_generation++;
+}
+
+void SystemRandomBytes(uint8_t *data, size_t bytes) {
+    size_t offset = 0;
+#if defined(__linux__)
+    while (offset < bytes) {
+        ssize_t read = getrandom(data + offset, bytes - offset, 0);
+        if (read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (read <= 0) {
+            break;
+        }
+        offset += read;
+    }
+#endif
+    // Seeding from partly filled buffers would make every generator predictable, so failures abort
+    // even in release builds
+    if (offset < bytes) {
+        FILE *file = std::fopen("/dev/urandom", "rb");
+        if (file == nullptr) {
+            std::abort();
+        }
+        size_t read;
+        while (offset < bytes && (read = std::fread(data + offset, 1, bytes - offset, file)) > 0) {
+            offset += read;
+        }
+        std::fclose(file);
+    }
+    if (offset != bytes) {
+        std::abort();
+    }
+}
+
+SecureRandom::SecureRandom() {
+    uint8_t seed[SEED_BYTES];
+    SystemRandomBytes(seed, SEED_BYTES);
+    Rekey(seed);
+    static std::once_flag registered;
+    std::call_once(registered, [] { pthread_atfork(nullptr, nullptr, OnFork); });
+    generation = fork_generation;
+}
+
+SecureRandom::~SecureRandom() = default;
+
+void SecureRandom::Fill(uint8_t *data, size_t bytes) {
+    // A forked child must not repeat the parent's pool
+    if (fork_generation != generation) {
+        Reseed();
+    }
+    while (bytes > 0) {
+        if (pool_offset == POOL_BYTES) {
+            if (generated >= RESEED_BYTES) {
+                Reseed();
+            }
+            // Large requests skip the pool and get keystream written in place
+            if (bytes >= POOL_BYTES) {
+                size_t blocks = bytes / 16;
+                Generate(data, blocks);
+                data += blocks * 16;
+                bytes -= blocks * 16;
+                uint8_t seed[SEED_BYTES];
+                Generate(seed, SEED_BYTES / 16);
+                Rekey(seed);
+                continue;
+            }
+            Refill();
+        }
+        size_t count = std::min(bytes, POOL_BYTES - pool_offset);
+        std::copy(pool + pool_offset, pool + pool_offset + count, data);
+        // Served bytes are wiped so they do not stay in the state
+        std::fill(pool + pool_offset, pool + pool_offset + count, 0);
+        pool_offset += count;
+        data += count;
+        bytes -= count;
+    }
+}
+
+SecureRandom::result_type SecureRandom::operator()() {
+    result_type value;
+    Fill(reinterpret_cast<uint8_t *>(&value), sizeof(value));
+    return value;
+}
+
+void SecureRandom::Reseed() {
+    uint8_t seed[SEED_BYTES];
+    uint8_t entropy[SEED_BYTES];
+    Generate(seed, SEED_BYTES / 16);
+    SystemRandomBytes(entropy, SEED_BYTES);
+    XorBytes(seed, entropy, SEED_BYTES);
+    Rekey(seed);
+    pool_offset = POOL_BYTES;
+    generated = 0;
+    generation = fork_generation;
+}
+
+void SecureRandom::Generate(uint8_t *blocks, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        std::copy(counter, counter + 16, blocks + i * 16);
+        // 128-bit little-endian increment
+        for (uint8_t &byte : counter) {
+            if (++byte != 0) {
+                break;
+            }
+        }
+    }
+    aes->EncryptBlocks(blocks, n);
+    generated += n * 16;
+}
+
+void SecureRandom::Rekey(const uint8_t *seed) {
+    aes = std::make_unique<AES>(AES::Type::AES256, std::string(seed, seed + 32));
+    std::copy(seed + 32, seed + SEED_BYTES, counter);
+}
+
+void SecureRandom::Refill() {
+    Generate(pool, POOL_BYTES / 16);
+    uint8_t seed[SEED_BYTES];
+    Generate(seed, SEED_BYTES / 16);
+    Rekey(seed);
+    pool_offset = 0;
+}
+
+SecureRandom &GetThreadRandom() {
+    thread_local SecureRandom random;
+    return random;
+}
+
+void RandomBytes(uint8_t *data, size_t bytes) {
+    GetThreadRandom().Fill(data, bytes);
+}
+
+std::vector<uint8_t> RandomBytes(size_t bytes) {
+    std::vector<uint8_t> data(bytes);
+    RandomBytes(data.data(), bytes);
+    return data;
+}
@@ -1,33 +1,132 @@
 #include <crypto330/stream/rc4.hpp>
+#include <crypto330/utils.hpp>
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
 void RC4::Encrypt(std::vector<uint8_t> &data) const {
-    ProcessData(data);
+    Stream(*this).Update(data.data(), data.data(), data.size());
 }
 
 void RC4::Decrypt(std::vector<uint8_t> &data) const {
-    ProcessData(data);
+    Stream(*this).Update(data.data(), data.data(), data.size());
 }
 
-void RC4::ProcessData(std::vector<uint8_t> &data) const {
-    uint8_t s[256];
+void RC4::Encrypt(const uint8_t *in, uint8_t *out, size_t length) const {
+    Stream(*this).Update(in, out, length);
+}
+
+void RC4::Decrypt(const uint8_t *in, uint8_t *out, size_t length) const {
+    Stream(*this).Update(in, out, length);
+}
+
+RC4::RC4(const std::string &key) {
+    assert(key.size() > 4 && key.size() <= 256);
+    uint8_t *s = initial_state;
     for(uint64_t i = 0; i < 256; i++) {
         s[i] = i;
     }
     for(uint64_t i = 0, j = 0; i < 256; i++) {
-        j = (j + s[i] + key[i % key.size()]) & 0xff;
+        j = (j + s[i] + uint8_t(key[i % key.size()])) & 0xff;
         std::swap(s[i], s[j]);
     }
+}
 
-    uint8_t i = 0, j = 0;
-    for(uint64_t byte = 0; byte < data.size(); byte++) {
-        i++;
-        j+= s[i];
-        std::swap(s[i], s[j]);
-        data[byte] ^= s[(s[i] + s[j]) & 0xff];
+// One PRGA step of a batch lane, returns the keystream byte
+inline uint8_t RC4_Step(uint8_t *s, uint32_t &x, uint32_t &y) {
+    x = (x + 1) & 0xffu;
+    uint32_t a = s[x];
+    y = (y + a) & 0xffu;
+    uint32_t b = s[y];
+    s[x] = b;
+    s[y] = a;
+    return s[(a + b) & 0xffu];
+}
+
+RC4::Stream::Stream(const RC4 &cipher) {
+    std::memcpy(s, cipher.initial_state, sizeof(s));
+}
+
+void RC4::Stream::Update(const uint8_t *in, uint8_t *out, size_t length) {
+    uint8_t x = i, y = j;
+    for(uint64_t byte = 0; byte < length; byte++) {
+        x++;
+        uint8_t a = s[x];
+        y += a;
+        uint8_t b = s[y];
+        s[x] = b;
+        s[y] = a;
+        out[byte] = in[byte] ^ s[uint8_t(a + b)];
     }
+    i = x;
+    j = y;
 }
 
-RC4::RC4(const std::string &key):key(key) {
-    assert(key.size() > 4 && key.size() <= 256);
+void RC4::UpdateBatch(const Job *jobs, size_t count) {
+    static_assert(BATCH_LANES == 4, "the interleaved loop is written for four lanes");
+    // lanes[0 .. active) hold jobs in progress, offsets[k] bytes of lane k are done
+    Job lanes[BATCH_LANES];
+    size_t offsets[BATCH_LANES];
+    size_t active = 0, next = 0;
+    for (; active < BATCH_LANES && next < count; active++, next++) {
+        lanes[active] = jobs[next];
+        offsets[active] = 0;
+    }
+
+    while (active == BATCH_LANES) {
+        size_t steps = SIZE_MAX;
+        for (size_t k = 0; k < BATCH_LANES; k++) {
+            steps = std::min(steps, lanes[k].length - offsets[k]);
+        }
+        // Keystream goes to a small buffer first, so the loop does not need the data pointers
+        const size_t CHUNK_BYTES = 256;
+        uint8_t keystream[BATCH_LANES][CHUNK_BYTES];
+        for (size_t done = 0; done < steps; done += CHUNK_BYTES) {
+            size_t chunk = std::min(CHUNK_BYTES, steps - done);
+            // Named lanes keep every S-box pointer and index in a register
+            uint8_t *s0 = lanes[0].stream->s, *s1 = lanes[1].stream->s;
+            uint8_t *s2 = lanes[2].stream->s, *s3 = lanes[3].stream->s;
+            uint32_t x0 = lanes[0].stream->i, x1 = lanes[1].stream->i, x2 = lanes[2].stream->i, x3 = lanes[3].stream->i;
+            uint32_t y0 = lanes[0].stream->j, y1 = lanes[1].stream->j, y2 = lanes[2].stream->j, y3 = lanes[3].stream->j;
+            for (size_t step = 0; step < chunk; step++) {
+                // Lanes are independent, so their load/store chains are in flight together
+                keystream[0][step] = RC4_Step(s0, x0, y0);
+                keystream[1][step] = RC4_Step(s1, x1, y1);
+                keystream[2][step] = RC4_Step(s2, x2, y2);
+                keystream[3][step] = RC4_Step(s3, x3, y3);
+            }
+            uint32_t x[BATCH_LANES] = {x0, x1, x2, x3}, y[BATCH_LANES] = {y0, y1, y2, y3};
+            for (size_t k = 0; k < BATCH_LANES; k++) {
+                lanes[k].stream->i = x[k];
+                lanes[k].stream->j = y[k];
+                size_t position = offsets[k] + done;
+                if (lanes[k].in != lanes[k].out) {
+                    std::memcpy(lanes[k].out + position, lanes[k].in + position, chunk);
+                }
+                XorBytes(lanes[k].out + position, keystream[k], chunk);
+            }
+        }
+        for (size_t k = 0; k < BATCH_LANES; k++) {
+            offsets[k] += steps;
+        }
+
+        // Finished lanes take the next job, or are dropped once the jobs run out
+        for (size_t k = active; k-- > 0;) {
+            if (offsets[k] < lanes[k].length) {
+                continue;
+            }
+            if (next < count) {
+                lanes[k] = jobs[next++];
+                offsets[k] = 0;
+            } else {
+                active--;
+                lanes[k] = lanes[active];
+                offsets[k] = offsets[active];
+            }
+        }
+    }
+
+    for (size_t k = 0; k < active; k++) {
+        lanes[k].stream->Update(lanes[k].in + offsets[k], lanes[k].out + offsets[k], lanes[k].length - offsets[k]);
+    }
 }
@@ -2,6 +2,7 @@
 #include <crypto330/hugeint/math.hpp>
 #include <cassert>
 #include <crypto330/hash/sha256.hpp>
+#include <crypto330/random.hpp>
 #include <iostream>
 
 const bool USE_DECRYPT_OPTIMIZATION = true;
@@ -115,10 +116,7 @@ namespace RSA {
         data.insert(data.end(), (uint8_t *) &size, ((uint8_t *) &size) + sizeof(uint64_t));
         std::vector<uint8_t> res;
         for (uint64_t offset = 0; offset < data.size(); offset += (block_size - k0 - k1) / 8) {
-            std::vector<uint8_t> r(k0 / 8);
-            for (uint64_t i = 0; i * 8 < k0; i++) {
-                r[i] = rand() >> 2;
-            }
+            std::vector<uint8_t> r = RandomBytes(k0 / 8);
             std::vector<uint8_t> X((block_size - k0) / 8);
             std::copy(data.begin() + offset, data.begin() + offset + (block_size - k0 - k1) / 8, X.begin());
             std::vector<uint8_t> G = hash(r, block_size - k0);
@@ -1,4 +1,5 @@
 #include <crypto330/stream/salsa.hpp>
+#include <crypto330/utils.hpp>
 #include <cassert>
 
 uint32_t rot(uint32_t a, uint32_t b) {
@@ -12,46 +13,59 @@ void qr(uint32_t &a, uint32_t &b, uint32_t &c, uint32_t &d) {
     a ^= rot(d + c, 18);
 }
 
-void Salsa::ProcessData(std::vector<uint8_t> &data) const {
-    uint32_t state[16];
-    uint32_t key_pos[] = {1, 2, 3, 4, 11, 12, 13, 14};
-
-    for (uint64_t byte = 0; byte < data.size(); byte++) {
-        if (byte % 64 == 0) {
-            state[0] = 0x61707865;
-            state[5] = 0x3320646e;
-            state[10] = 0x79622d32;
-            state[15] = 0x6b206574;
-            for (uint64_t i = 0; i < 8; i++) {
-                state[key_pos[i]] = key[i];
-            }
-            state[6] = state[8] = byte >> 32;
-            state[7] = state[9] = byte & 0xFFFFFFFF;
-
-            for (uint32_t i = 0; i < 10; i++) {
-                qr(state[0], state[4], state[8], state[12]);    // column 1
-                qr(state[5], state[9], state[13], state[1]);    // column 2
-                qr(state[10], state[14], state[2], state[6]);    // column 3
-                qr(state[15], state[3], state[7], state[11]);    // column 4
-                qr(state[0], state[1], state[2], state[3]);    // row 1
-                qr(state[5], state[6], state[7], state[4]);    // row 2
-                qr(state[10], state[11], state[8], state[9]);    // row 3
-                qr(state[15], state[12], state[13], state[14]);    // row 4
-            }
-        }
-        data[byte] ^= reinterpret_cast<uint8_t*>(state)[byte % 64];
+Salsa::Salsa(const std::string &key_str, bool hex, const std::vector<uint8_t> &nonce, Engine engine)
+        : KeystreamCipher(engine) {
+    std::vector<uint8_t> key = hex ? HexStringToBytes(key_str) : StringToBytes(key_str);
+    assert(key.size() <= 32);
+    assert(nonce.empty() || nonce.size() == NONCE_BYTES);
+    // "expand 16-byte k" repeats a 16-byte key, "expand 32-byte k" is used otherwise
+    bool short_key = key.size() == 16;
+    key.resize(32, 0);
+    if (short_key) {
+        std::copy(key.begin(), key.begin() + 16, key.begin() + 16);
+    }
+    state[0] = 0x61707865;
+    state[5] = short_key ? 0x3120646e : 0x3320646e;
+    state[10] = short_key ? 0x79622d36 : 0x79622d32;
+    state[15] = 0x6b206574;
+    std::memcpy(state + 1, key.data(), 16);
+    std::memcpy(state + 11, key.data() + 16, 16);
+    if (!nonce.empty()) {
+        std::memcpy(state + 6, nonce.data(), NONCE_BYTES);
     }
 }
 
-void Salsa::Encrypt(std::vector<uint8_t> &data) const {
-    ProcessData(data);
-}
-
-void Salsa::Decrypt(std::vector<uint8_t> &data) const {
-    ProcessData(data);
-}
-
-Salsa::Salsa(const std::string &key_str) {
-    assert(key_str.size() <= 32);
-    std::copy(key_str.begin(), key_str.end(), (uint8_t*)key);
+void Salsa::GenerateBlocks(uint64_t counter, uint8_t *blocks, size_t n, Engine engine) const {
+    // The widest kernel takes whole groups, narrower ones take what is left
+    size_t done = 0;
+    if (engine >= Engine::AVX512) {
+        done += Salsa_BlocksAVX512(state, counter, blocks, n);
+    }
+    if (engine >= Engine::AVX2) {
+        done += Salsa_BlocksAVX2(state, counter + done, blocks + done * BLOCK_BYTES, n - done);
+    }
+    if (engine >= Engine::SSE2) {
+        done += Salsa_BlocksSSE2(state, counter + done, blocks + done * BLOCK_BYTES, n - done);
+    }
+    for (; done < n; done++) {
+        uint32_t x[16], input[16];
+        std::memcpy(input, state, sizeof(input));
+        input[8] = uint32_t(counter + done);
+        input[9] = uint32_t((counter + done) >> 32u);
+        std::memcpy(x, input, sizeof(x));
+        for (uint32_t i = 0; i < 10; i++) {
+            qr(x[0], x[4], x[8], x[12]);    // column 1
+            qr(x[5], x[9], x[13], x[1]);    // column 2
+            qr(x[10], x[14], x[2], x[6]);    // column 3
+            qr(x[15], x[3], x[7], x[11]);    // column 4
+            qr(x[0], x[1], x[2], x[3]);    // row 1
+            qr(x[5], x[6], x[7], x[4]);    // row 2
+            qr(x[10], x[11], x[8], x[9]);    // row 3
+            qr(x[15], x[12], x[13], x[14]);    // row 4
+        }
+        for (uint32_t i = 0; i < 16; i++) {
+            x[i] += input[i];
+        }
+        std::memcpy(blocks + done * BLOCK_BYTES, x, BLOCK_BYTES);
+    }
 }
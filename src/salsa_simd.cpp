@@ -0,0 +1,226 @@
+#include <crypto330/stream/salsa.hpp>
+#include <crypto330/utils.hpp>
+
+#ifdef CRYPTO330_X86
+
+#include <immintrin.h>
+
+// Word i of every block sits in vector x[i], one block per 32-bit lane, so the quarter-rounds
+// run on 4 (SSE2), 8 (AVX2) or 16 (AVX512) blocks at once and the result is transposed back into blocks.
+
+__attribute__((target("sse2"), always_inline))
+inline __m128i Salsa_Rotate128(__m128i x, int bits) {
+    return _mm_or_si128(_mm_slli_epi32(x, bits), _mm_srli_epi32(x, 32 - bits));
+}
+
+__attribute__((target("sse2"), always_inline))
+inline void Salsa_QuarterRound128(__m128i &a, __m128i &b, __m128i &c, __m128i &d) {
+    b = _mm_xor_si128(b, Salsa_Rotate128(_mm_add_epi32(a, d), 7));
+    c = _mm_xor_si128(c, Salsa_Rotate128(_mm_add_epi32(b, a), 9));
+    d = _mm_xor_si128(d, Salsa_Rotate128(_mm_add_epi32(c, b), 13));
+    a = _mm_xor_si128(a, Salsa_Rotate128(_mm_add_epi32(d, c), 18));
+}
+
+__attribute__((target("sse2")))
+size_t Salsa_BlocksSSE2(const uint32_t *state, uint64_t counter, uint8_t *blocks, size_t n) {
+    size_t done = 0;
+    for (; done + 4 <= n; done += 4) {
+        __m128i input[16];
+        for (uint32_t i = 0; i < 16; i++) {
+            input[i] = _mm_set1_epi32(state[i]);
+        }
+        uint32_t low[4], high[4];
+        for (uint32_t j = 0; j < 4; j++) {
+            low[j] = uint32_t(counter + done + j);
+            high[j] = uint32_t((counter + done + j) >> 32u);
+        }
+        input[8] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(low));
+        input[9] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(high));
+
+        __m128i x[16];
+        for (uint32_t i = 0; i < 16; i++) {
+            x[i] = input[i];
+        }
+        for (uint32_t round = 0; round < 10; round++) {
+            Salsa_QuarterRound128(x[0], x[4], x[8], x[12]);
+            Salsa_QuarterRound128(x[5], x[9], x[13], x[1]);
+            Salsa_QuarterRound128(x[10], x[14], x[2], x[6]);
+            Salsa_QuarterRound128(x[15], x[3], x[7], x[11]);
+            Salsa_QuarterRound128(x[0], x[1], x[2], x[3]);
+            Salsa_QuarterRound128(x[5], x[6], x[7], x[4]);
+            Salsa_QuarterRound128(x[10], x[11], x[8], x[9]);
+            Salsa_QuarterRound128(x[15], x[12], x[13], x[14]);
+        }
+
+        uint8_t *out = blocks + done * 64;
+        for (uint32_t group = 0; group < 4; group++) {
+            __m128i a = _mm_add_epi32(x[group * 4], input[group * 4]);
+            __m128i b = _mm_add_epi32(x[group * 4 + 1], input[group * 4 + 1]);
+            __m128i c = _mm_add_epi32(x[group * 4 + 2], input[group * 4 + 2]);
+            __m128i d = _mm_add_epi32(x[group * 4 + 3], input[group * 4 + 3]);
+            __m128i ab_low = _mm_unpacklo_epi32(a, b), ab_high = _mm_unpackhi_epi32(a, b);
+            __m128i cd_low = _mm_unpacklo_epi32(c, d), cd_high = _mm_unpackhi_epi32(c, d);
+            uint8_t *words = out + group * 16;
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(words), _mm_unpacklo_epi64(ab_low, cd_low));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(words + 64), _mm_unpackhi_epi64(ab_low, cd_low));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(words + 128), _mm_unpacklo_epi64(ab_high, cd_high));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(words + 192), _mm_unpackhi_epi64(ab_high, cd_high));
+        }
+    }
+    return done;
+}
+
+__attribute__((target("avx2"), always_inline))
+inline __m256i Salsa_Rotate256(__m256i x, int bits) {
+    return _mm256_or_si256(_mm256_slli_epi32(x, bits), _mm256_srli_epi32(x, 32 - bits));
+}
+
+__attribute__((target("avx2"), always_inline))
+inline void Salsa_QuarterRound256(__m256i &a, __m256i &b, __m256i &c, __m256i &d) {
+    b = _mm256_xor_si256(b, Salsa_Rotate256(_mm256_add_epi32(a, d), 7));
+    c = _mm256_xor_si256(c, Salsa_Rotate256(_mm256_add_epi32(b, a), 9));
+    d = _mm256_xor_si256(d, Salsa_Rotate256(_mm256_add_epi32(c, b), 13));
+    a = _mm256_xor_si256(a, Salsa_Rotate256(_mm256_add_epi32(d, c), 18));
+}
+
+__attribute__((target("avx2")))
+size_t Salsa_BlocksAVX2(const uint32_t *state, uint64_t counter, uint8_t *blocks, size_t n) {
+    size_t done = 0;
+    for (; done + 8 <= n; done += 8) {
+        __m256i input[16];
+        for (uint32_t i = 0; i < 16; i++) {
+            input[i] = _mm256_set1_epi32(state[i]);
+        }
+        uint32_t low[8], high[8];
+        for (uint32_t j = 0; j < 8; j++) {
+            low[j] = uint32_t(counter + done + j);
+            high[j] = uint32_t((counter + done + j) >> 32u);
+        }
+        input[8] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(low));
+        input[9] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(high));
+
+        __m256i x[16];
+        for (uint32_t i = 0; i < 16; i++) {
+            x[i] = input[i];
+        }
+        for (uint32_t round = 0; round < 10; round++) {
+            Salsa_QuarterRound256(x[0], x[4], x[8], x[12]);
+            Salsa_QuarterRound256(x[5], x[9], x[13], x[1]);
+            Salsa_QuarterRound256(x[10], x[14], x[2], x[6]);
+            Salsa_QuarterRound256(x[15], x[3], x[7], x[11]);
+            Salsa_QuarterRound256(x[0], x[1], x[2], x[3]);
+            Salsa_QuarterRound256(x[5], x[6], x[7], x[4]);
+            Salsa_QuarterRound256(x[10], x[11], x[8], x[9]);
+            Salsa_QuarterRound256(x[15], x[12], x[13], x[14]);
+        }
+
+        // Lanes 0-3 are transposed in the low halves and lanes 4-7 in the high halves
+        uint8_t *out = blocks + done * 64;
+        for (uint32_t group = 0; group < 4; group++) {
+            __m256i a = _mm256_add_epi32(x[group * 4], input[group * 4]);
+            __m256i b = _mm256_add_epi32(x[group * 4 + 1], input[group * 4 + 1]);
+            __m256i c = _mm256_add_epi32(x[group * 4 + 2], input[group * 4 + 2]);
+            __m256i d = _mm256_add_epi32(x[group * 4 + 3], input[group * 4 + 3]);
+            __m256i ab_low = _mm256_unpacklo_epi32(a, b), ab_high = _mm256_unpackhi_epi32(a, b);
+            __m256i cd_low = _mm256_unpacklo_epi32(c, d), cd_high = _mm256_unpackhi_epi32(c, d);
+            __m256i words[4] = {_mm256_unpacklo_epi64(ab_low, cd_low), _mm256_unpackhi_epi64(ab_low, cd_low),
+                                _mm256_unpacklo_epi64(ab_high, cd_high), _mm256_unpackhi_epi64(ab_high, cd_high)};
+            for (uint32_t j = 0; j < 4; j++) {
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + j * 64 + group * 16),
+                                 _mm256_castsi256_si128(words[j]));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + (j + 4) * 64 + group * 16),
+                                 _mm256_extracti128_si256(words[j], 1));
+            }
+        }
+    }
+    return done;
+}
+
+// Full-mask maskz intrinsics keep GCC 12 quiet, see ChaCha_QuarterRound512
+__attribute__((target("avx512f"), always_inline))
+inline void Salsa_QuarterRound512(__m512i &a, __m512i &b, __m512i &c, __m512i &d) {
+    b = _mm512_xor_si512(b, _mm512_maskz_rol_epi32(0xffff, _mm512_add_epi32(a, d), 7));
+    c = _mm512_xor_si512(c, _mm512_maskz_rol_epi32(0xffff, _mm512_add_epi32(b, a), 9));
+    d = _mm512_xor_si512(d, _mm512_maskz_rol_epi32(0xffff, _mm512_add_epi32(c, b), 13));
+    a = _mm512_xor_si512(a, _mm512_maskz_rol_epi32(0xffff, _mm512_add_epi32(d, c), 18));
+}
+
+__attribute__((target("avx512f")))
+size_t Salsa_BlocksAVX512(const uint32_t *state, uint64_t counter, uint8_t *blocks, size_t n) {
+    size_t done = 0;
+    for (; done + 16 <= n; done += 16) {
+        __m512i input[16];
+        for (uint32_t i = 0; i < 16; i++) {
+            input[i] = _mm512_set1_epi32(state[i]);
+        }
+        uint32_t low[16], high[16];
+        for (uint32_t j = 0; j < 16; j++) {
+            low[j] = uint32_t(counter + done + j);
+            high[j] = uint32_t((counter + done + j) >> 32u);
+        }
+        input[8] = _mm512_loadu_si512(low);
+        input[9] = _mm512_loadu_si512(high);
+
+        __m512i x[16];
+        for (uint32_t i = 0; i < 16; i++) {
+            x[i] = input[i];
+        }
+        for (uint32_t round = 0; round < 10; round++) {
+            Salsa_QuarterRound512(x[0], x[4], x[8], x[12]);
+            Salsa_QuarterRound512(x[5], x[9], x[13], x[1]);
+            Salsa_QuarterRound512(x[10], x[14], x[2], x[6]);
+            Salsa_QuarterRound512(x[15], x[3], x[7], x[11]);
+            Salsa_QuarterRound512(x[0], x[1], x[2], x[3]);
+            Salsa_QuarterRound512(x[5], x[6], x[7], x[4]);
+            Salsa_QuarterRound512(x[10], x[11], x[8], x[9]);
+            Salsa_QuarterRound512(x[15], x[12], x[13], x[14]);
+        }
+
+        // Every 128-bit quarter q is transposed on its own and holds lanes 4q to 4q+3
+        uint8_t *out = blocks + done * 64;
+        for (uint32_t group = 0; group < 4; group++) {
+            __m512i a = _mm512_add_epi32(x[group * 4], input[group * 4]);
+            __m512i b = _mm512_add_epi32(x[group * 4 + 1], input[group * 4 + 1]);
+            __m512i c = _mm512_add_epi32(x[group * 4 + 2], input[group * 4 + 2]);
+            __m512i d = _mm512_add_epi32(x[group * 4 + 3], input[group * 4 + 3]);
+            __m512i ab_low = _mm512_maskz_unpacklo_epi32(0xffff, a, b);
+            __m512i ab_high = _mm512_maskz_unpackhi_epi32(0xffff, a, b);
+            __m512i cd_low = _mm512_maskz_unpacklo_epi32(0xffff, c, d);
+            __m512i cd_high = _mm512_maskz_unpackhi_epi32(0xffff, c, d);
+            __m512i words[4] = {_mm512_maskz_unpacklo_epi64(0xff, ab_low, cd_low),
+                                _mm512_maskz_unpackhi_epi64(0xff, ab_low, cd_low),
+                                _mm512_maskz_unpacklo_epi64(0xff, ab_high, cd_high),
+                                _mm512_maskz_unpackhi_epi64(0xff, ab_high, cd_high)};
+            for (uint32_t j = 0; j < 4; j++) {
+                uint8_t *block = out + j * 64 + group * 16;
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(block),
+                                 _mm512_maskz_extracti32x4_epi32(0xf, words[j], 0));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(block + 256),
+                                 _mm512_maskz_extracti32x4_epi32(0xf, words[j], 1));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(block + 512),
+                                 _mm512_maskz_extracti32x4_epi32(0xf, words[j], 2));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(block + 768),
+                                 _mm512_maskz_extracti32x4_epi32(0xf, words[j], 3));
+            }
+        }
+    }
+    return done;
+}
+
+#else
+
+// Only the portable engine is available on other architectures
+
+size_t Salsa_BlocksSSE2(const uint32_t *state, uint64_t counter, uint8_t *blocks, size_t n) {
+    return 0;
+}
+
+size_t Salsa_BlocksAVX2(const uint32_t *state, uint64_t counter, uint8_t *blocks, size_t n) {
+    return 0;
+}
+
+size_t Salsa_BlocksAVX512(const uint32_t *state, uint64_t counter, uint8_t *blocks, size_t n) {
+    return 0;
+}
+
+#endif
@@ -1,7 +1,10 @@
 #include <crypto330/hash/sha256.hpp>
+#include <crypto330/utils.hpp>
+#include <algorithm>
+#include <cassert>
 #include <iostream>
 
-uint32_t roots[64] = {
+const uint32_t SHA256_K[64] = {
         0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
         0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
         0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
@@ -12,58 +15,244 @@ uint32_t roots[64] = {
         0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
 };
 
+const uint32_t SHA256_IV[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
 inline uint32_t rot_right(uint32_t x, uint8_t n) {
     return (x >> n) | (x << (32u - n));
 }
 
-std::vector<uint8_t> Sha256::GetHash(const std::vector<uint8_t> &data) const {
-    uint64_t l = data.size() * 8; // length in bits
-    uint64_t blocks_num = (data.size() + 72) / 64; // number of blocks
-
-    uint8_t block[64];
-
-    uint32_t hash[8] = {
-            0x6a09e667,
-            0xbb67ae85,
-            0x3c6ef372,
-            0xa54ff53a,
-            0x510e527f,
-            0x9b05688c,
-            0x1f83d9ab,
-            0x5be0cd19
+Sha256::Sha256(Engine engine, Compression compression) : engine(engine), compression(compression) {
+    const CpuFeatures &features = GetCpuFeatures();
+    if (this->engine == Engine::Auto) {
+        this->engine = features.avx512f ? Engine::AVX512 : features.avx2 ? Engine::AVX2
+                     : features.sse2 ? Engine::SSE2 : Engine::Portable;
+    }
+    assert(this->engine != Engine::SSE2 || features.sse2);
+    assert(this->engine != Engine::AVX2 || features.avx2);
+    assert(this->engine != Engine::AVX512 || features.avx512f);
+
+    if (this->compression == Compression::Auto) {
+        this->compression = features.sha && features.ssse3 && features.sse41 ? Compression::SHANI
+                          : features.avx2 ? Compression::AVX2 : Compression::Scalar;
+    }
+    assert(this->compression != Compression::AVX2 || features.avx2);
+    assert(this->compression != Compression::SHANI || (features.sha && features.ssse3 && features.sse41));
+
+    Reset();
+}
+
+std::vector<uint8_t> Sha256::GetHash(const uint8_t *data, size_t length) const {
+    uint32_t hash[8];
+    std::copy(SHA256_IV, SHA256_IV + 8, hash);
+
+    // Whole blocks are compressed in place, only the padded tail is copied
+    size_t full_blocks = length / 64;
+    ProcessBlocks(data, full_blocks, hash);
+    return Finish(hash, data + full_blocks * 64, length % 64, length);
+}
+
+void Sha256::Update(const uint8_t *data, size_t length) {
+    stream_length += length;
+    if (buffered > 0) {
+        size_t take = std::min(length, 64 - buffered);
+        std::copy(data, data + take, stream_buffer + buffered);
+        buffered += take;
+        data += take;
+        length -= take;
+        if (buffered < 64) {
+            return;
+        }
+        ProcessBlocks(stream_buffer, 1, stream_hash);
+        buffered = 0;
+    }
+    ProcessBlocks(data, length / 64, stream_hash);
+    std::copy(data + length / 64 * 64, data + length, stream_buffer);
+    buffered = length % 64;
+}
+
+std::vector<uint8_t> Sha256::Final() {
+    std::vector<uint8_t> digest = Finish(stream_hash, stream_buffer, buffered, stream_length);
+    Reset();
+    return digest;
+}
+
+void Sha256::Reset() {
+    std::copy(SHA256_IV, SHA256_IV + 8, stream_hash);
+    buffered = 0;
+    stream_length = 0;
+}
+
+std::vector<uint8_t> Sha256::Finish(uint32_t *hash, const uint8_t *rest_data, size_t rest, uint64_t length) const {
+    uint8_t tail[128] = {};
+    size_t tail_bytes = rest + 9 <= 64 ? 64 : 128;
+    std::copy(rest_data, rest_data + rest, tail);
+    tail[rest] = 0x80;
+    StoreBigEndian64(tail + tail_bytes - 8, length * 8);
+    ProcessBlocks(tail, tail_bytes / 64, hash);
+
+    std::vector<uint8_t> hash_bytes(32);
+    for (uint8_t i = 0; i < 8; i++) {
+        StoreBigEndian32(hash_bytes.data() + i * 4, hash[i]);
+    }
+    return hash_bytes;
+}
+
+uint64_t Sha256::GetBlockSize() const {
+    return 64;
+}
+
+uint64_t Sha256::GetDigestSize() const {
+    return 32;
+}
+
+std::vector<std::vector<uint8_t>> Sha256::GetHashes(const std::vector<std::vector<uint8_t>> &messages) const {
+    std::vector<const uint8_t *> pointers;
+    std::vector<size_t> lengths;
+    for (const auto &message : messages) {
+        pointers.push_back(message.data());
+        lengths.push_back(message.size());
+    }
+    std::vector<uint8_t> digests(messages.size() * 32);
+    GetHashes(pointers.data(), lengths.data(), messages.size(), digests.data());
+
+    std::vector<std::vector<uint8_t>> result;
+    for (size_t i = 0; i < messages.size(); i++) {
+        result.emplace_back(digests.begin() + i * 32, digests.begin() + (i + 1) * 32);
+    }
+    return result;
+}
+
+void Sha256::GetHashes(const uint8_t *const *messages, const size_t *lengths, size_t count, uint8_t *digests) const {
+    const size_t MAX_LANES = 16;
+    size_t lanes = engine == Engine::AVX512 ? 16 : engine == Engine::AVX2 ? 8 : engine == Engine::SSE2 ? 4 : 1;
+
+    // Every lane runs through the whole blocks of its message in place, then through one or two
+    // padded tail blocks built in its own buffer
+    struct Lane {
+        size_t message;
+        size_t done;
+        size_t full_blocks;
+        size_t total_blocks;
+        uint8_t tail[128];
     };
+    Lane lane_state[MAX_LANES];
+    uint32_t state[8 * MAX_LANES];
+    const uint8_t *data[MAX_LANES];
+    uint32_t active = 0;
+    size_t next = 0;
 
-    for (uint64_t i = 0; i < blocks_num; i++) {
-        uint64_t offset = i * 64;
-        std::fill(block, block + 64, 0);
-        if (i == blocks_num - 1) {
-            if (offset <= data.size()) {
-                std::copy(data.begin() + offset, data.end(), block);
-                block[data.size() - offset] = 0x80;
+    auto start = [&](size_t k) {
+        Lane &lane = lane_state[k];
+        lane.message = next++;
+        size_t length = lengths[lane.message];
+        size_t rest = length % 64;
+        lane.done = 0;
+        lane.full_blocks = length / 64;
+        lane.total_blocks = lane.full_blocks + (rest + 9 <= 64 ? 1 : 2);
+        size_t tail_bytes = (lane.total_blocks - lane.full_blocks) * 64;
+        std::fill(lane.tail, lane.tail + tail_bytes, 0);
+        if (rest > 0) {
+            std::copy(messages[lane.message] + length - rest, messages[lane.message] + length, lane.tail);
+        }
+        lane.tail[rest] = 0x80;
+        StoreBigEndian64(lane.tail + tail_bytes - 8, uint64_t(length) * 8);
+        for (size_t i = 0; i < 8; i++) {
+            state[i * lanes + k] = SHA256_IV[i];
+        }
+        active |= 1u << k;
+    };
+
+    for (size_t k = 0; k < lanes && next < count; k++) {
+        start(k);
+    }
+    while (active != 0) {
+        // Every active lane can take steps blocks from one contiguous run
+        size_t steps = SIZE_MAX;
+        for (size_t k = 0; k < lanes; k++) {
+            data[k] = nullptr;
+            if (!(active & (1u << k))) {
+                continue;
+            }
+            Lane &lane = lane_state[k];
+            if (lane.done < lane.full_blocks) {
+                data[k] = messages[lane.message] + lane.done * 64;
+                steps = std::min(steps, lane.full_blocks - lane.done);
+            } else {
+                data[k] = lane.tail + (lane.done - lane.full_blocks) * 64;
+                steps = std::min(steps, lane.total_blocks - lane.done);
+            }
+        }
+        // A single message left, usually the longest one, is not worth a whole vector
+        if (lanes > 1 && (active & (active - 1)) == 0) {
+            size_t k = __builtin_ctz(active);
+            uint32_t hash[8];
+            for (size_t i = 0; i < 8; i++) {
+                hash[i] = state[i * lanes + k];
             }
-            for (uint8_t j = 0; j < 8; j++) {
-                block[63 - j] = (l >> ((j * 8))) & 0xFF;
+            ProcessBlocks(data[k], steps, hash);
+            for (size_t i = 0; i < 8; i++) {
+                state[i * lanes + k] = hash[i];
             }
         } else {
-            std::copy(data.begin() + offset, std::min(data.begin() + offset + 64, data.end()), block);
-            if (offset + 64 > data.size()) {
-                block[data.size() - offset] = 0x80;
+            switch (engine) {
+                case Engine::AVX512:
+                    Sha256_BlocksAVX512(state, data, steps, active);
+                    break;
+                case Engine::AVX2:
+                    Sha256_BlocksAVX2(state, data, steps, active);
+                    break;
+                case Engine::SSE2:
+                    Sha256_BlocksSSE2(state, data, steps, active);
+                    break;
+                default:
+                    ProcessBlocks(data[0], steps, state);
+                    break;
+            }
+        }
+
+        for (size_t k = 0; k < lanes; k++) {
+            Lane &lane = lane_state[k];
+            if (!(active & (1u << k)) || (lane.done += steps) < lane.total_blocks) {
+                continue;
+            }
+            for (size_t i = 0; i < 8; i++) {
+                StoreBigEndian32(digests + lane.message * 32 + i * 4, state[i * lanes + k]);
+            }
+            active &= ~(1u << k);
+            if (next < count) {
+                start(k);
             }
         }
-        ProcessBlock(block, hash);
     }
+}
 
-    std::vector<uint8_t> hash_bytes(32);
-    for (uint8_t i = 0; i < 8; i++) {
-        hash_bytes[i * 4 + 3] = (hash[i] & 0x000000FF) >> 0;
-        hash_bytes[i * 4 + 2] = (hash[i] & 0x0000FF00) >> 8;
-        hash_bytes[i * 4 + 1] = (hash[i] & 0x00FF0000) >> 16;
-        hash_bytes[i * 4 + 0] = (hash[i] & 0xFF000000) >> 24;
+Sha256::Engine Sha256::GetEngine() const {
+    return engine;
+}
+
+Sha256::Compression Sha256::GetCompression() const {
+    return compression;
+}
+
+void Sha256::ProcessBlocks(const uint8_t *data, size_t n, uint32_t *hash) const {
+    switch (compression) {
+        case Compression::SHANI:
+            Sha256_CompressSHANI(hash, data, n);
+            break;
+        case Compression::AVX2:
+            Sha256_CompressAVX2(hash, data, n);
+            break;
+        default:
+            for (size_t block = 0; block < n; block++) {
+                ProcessBlock(data + block * 64, hash);
+            }
+            break;
     }
-    return hash_bytes;
 }
 
-void Sha256::ProcessBlock(uint8_t *data, uint32_t *hash) const {
+void Sha256::ProcessBlock(const uint8_t *data, uint32_t *hash) const {
     uint32_t w[64];
     for (uint32_t word = 0; word < 16; word++) {
         w[word] = 0;
@@ -90,7 +279,7 @@ void Sha256::ProcessBlock(uint8_t *data, uint32_t *hash) const {
 
     for (uint8_t i = 0; i < 64; i++) {
         uint32_t S1 = rot_right(e, 6) ^rot_right(e, 11) ^rot_right(e, 25);
-        uint32_t temp1 = h + S1 + ((e & f) ^ ((~e) & g)) + roots[i] + w[i];
+        uint32_t temp1 = h + S1 + ((e & f) ^ ((~e) & g)) + SHA256_K[i] + w[i];
         uint32_t S0 = rot_right(a, 2) ^rot_right(a, 13) ^rot_right(a, 22);
         uint32_t temp2 = S0 + ((a & b) ^(a & c) ^(b & c));
 
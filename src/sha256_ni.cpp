@@ -0,0 +1,58 @@
+#include <crypto330/hash/sha256.hpp>
+#include <crypto330/utils.hpp>
+
+#ifdef CRYPTO330_X86
+
+#include <immintrin.h>
+
+// SHA256RNDS2 keeps the state as ABEF / CDGH halves and runs two rounds per instruction with W + K
+// taken from the low 64 bits of its third operand. SHA256MSG1 / SHA256MSG2 build the next four
+// schedule words from the previous sixteen, with the W[t - 7] term added in between.
+
+__attribute__((target("sha,sse4.1,ssse3")))
+void Sha256_CompressSHANI(uint32_t *state, const uint8_t *data, size_t n) {
+    const __m128i BSWAP = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state)), 0xb1);
+    __m128i efgh = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state + 4)), 0x1b);
+    __m128i abef = _mm_alignr_epi8(abcd, efgh, 8);
+    __m128i cdgh = _mm_blend_epi16(efgh, abcd, 0xf0);
+
+    for (size_t block = 0; block < n; block++, data += 64) {
+        __m128i abef_saved = abef;
+        __m128i cdgh_saved = cdgh;
+        __m128i w[4];
+        // Group j covers rounds 4j .. 4j + 3, w[j % 4] holds its schedule words
+        for (size_t j = 0; j < 16; j++) {
+            if (j < 4) {
+                w[j] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + j * 16)), BSWAP);
+            }
+            __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i *>(SHA256_K + j * 4));
+            __m128i wk = _mm_add_epi32(w[j % 4], k);
+            cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk);
+            if (j >= 3 && j < 15) {
+                __m128i w7 = _mm_alignr_epi8(w[j % 4], w[(j + 3) % 4], 4);
+                w[(j + 1) % 4] = _mm_sha256msg2_epu32(_mm_add_epi32(w[(j + 1) % 4], w7), w[j % 4]);
+            }
+            abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(wk, 0x0e));
+            if (j >= 1 && j < 13) {
+                w[(j + 3) % 4] = _mm_sha256msg1_epu32(w[(j + 3) % 4], w[j % 4]);
+            }
+        }
+        abef = _mm_add_epi32(abef, abef_saved);
+        cdgh = _mm_add_epi32(cdgh, cdgh_saved);
+    }
+
+    __m128i feba = _mm_shuffle_epi32(abef, 0x1b);
+    __m128i dchg = _mm_shuffle_epi32(cdgh, 0xb1);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(state), _mm_blend_epi16(feba, dchg, 0xf0));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(state + 4), _mm_alignr_epi8(dchg, feba, 8));
+}
+
+#else
+
+// SHANI is never selected on other architectures
+
+void Sha256_CompressSHANI(uint32_t *state, const uint8_t *data, size_t n) {}
+
+#endif
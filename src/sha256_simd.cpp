@@ -0,0 +1,293 @@
+#include <crypto330/hash/sha256.hpp>
+#include <crypto330/utils.hpp>
+
+#ifdef CRYPTO330_X86
+
+#include <immintrin.h>
+
+// Word i of every lane sits in one vector, one message per 32-bit lane. Message words are loaded
+// big-endian into a transposed buffer for the active lanes only, the rounds are the scalar ones
+// applied to whole vectors, and the final addition is masked so idle lanes keep their state.
+
+__attribute__((target("sse2"), always_inline))
+inline __m128i Sha256_Rotate128(__m128i x, int bits) {
+    return _mm_or_si128(_mm_srli_epi32(x, bits), _mm_slli_epi32(x, 32 - bits));
+}
+
+__attribute__((target("sse2")))
+void Sha256_BlocksSSE2(uint32_t *state, const uint8_t *const *data, size_t n, uint32_t active) {
+    const size_t LANES = 4;
+    alignas(16) uint32_t mask_words[LANES];
+    for (size_t k = 0; k < LANES; k++) {
+        mask_words[k] = (active >> k) & 1u ? UINT32_MAX : 0;
+    }
+    __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i *>(mask_words));
+    __m128i hash[8];
+    for (size_t i = 0; i < 8; i++) {
+        hash[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(state + i * LANES));
+    }
+    alignas(16) uint32_t words[16][LANES] = {};
+    for (size_t block = 0; block < n; block++) {
+        for (size_t k = 0; k < LANES; k++) {
+            if ((active >> k) & 1u) {
+                for (size_t i = 0; i < 16; i++) {
+                    words[i][k] = LoadBigEndian32(data[k] + block * 64 + i * 4);
+                }
+            }
+        }
+        __m128i w[16];
+        for (size_t i = 0; i < 16; i++) {
+            w[i] = _mm_load_si128(reinterpret_cast<const __m128i *>(words[i]));
+        }
+        __m128i a = hash[0], b = hash[1], c = hash[2], d = hash[3];
+        __m128i e = hash[4], f = hash[5], g = hash[6], h = hash[7];
+        for (size_t t = 0; t < 64; t++) {
+            if (t >= 16) {
+                __m128i x = w[(t + 1) % 16], y = w[(t + 14) % 16];
+                __m128i s0 = _mm_xor_si128(_mm_xor_si128(Sha256_Rotate128(x, 7), Sha256_Rotate128(x, 18)),
+                                           _mm_srli_epi32(x, 3));
+                __m128i s1 = _mm_xor_si128(_mm_xor_si128(Sha256_Rotate128(y, 17), Sha256_Rotate128(y, 19)),
+                                           _mm_srli_epi32(y, 10));
+                w[t % 16] = _mm_add_epi32(_mm_add_epi32(w[t % 16], s0), _mm_add_epi32(w[(t + 9) % 16], s1));
+            }
+            __m128i S1 = _mm_xor_si128(_mm_xor_si128(Sha256_Rotate128(e, 6), Sha256_Rotate128(e, 11)),
+                                       Sha256_Rotate128(e, 25));
+            __m128i ch = _mm_xor_si128(_mm_and_si128(e, f), _mm_andnot_si128(e, g));
+            __m128i temp1 = _mm_add_epi32(_mm_add_epi32(h, S1), _mm_add_epi32(ch, w[t % 16]));
+            temp1 = _mm_add_epi32(temp1, _mm_set1_epi32(SHA256_K[t]));
+            __m128i S0 = _mm_xor_si128(_mm_xor_si128(Sha256_Rotate128(a, 2), Sha256_Rotate128(a, 13)),
+                                       Sha256_Rotate128(a, 22));
+            __m128i maj = _mm_xor_si128(_mm_and_si128(_mm_xor_si128(a, b), c), _mm_and_si128(a, b));
+            __m128i temp2 = _mm_add_epi32(S0, maj);
+            h = g;
+            g = f;
+            f = e;
+            e = _mm_add_epi32(d, temp1);
+            d = c;
+            c = b;
+            b = a;
+            a = _mm_add_epi32(temp1, temp2);
+        }
+        __m128i result[8] = {a, b, c, d, e, f, g, h};
+        for (size_t i = 0; i < 8; i++) {
+            hash[i] = _mm_add_epi32(hash[i], _mm_and_si128(result[i], mask));
+        }
+    }
+    for (size_t i = 0; i < 8; i++) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(state + i * LANES), hash[i]);
+    }
+}
+
+__attribute__((target("avx2"), always_inline))
+inline __m256i Sha256_Rotate256(__m256i x, int bits) {
+    return _mm256_or_si256(_mm256_srli_epi32(x, bits), _mm256_slli_epi32(x, 32 - bits));
+}
+
+__attribute__((target("avx2")))
+void Sha256_BlocksAVX2(uint32_t *state, const uint8_t *const *data, size_t n, uint32_t active) {
+    const size_t LANES = 8;
+    alignas(32) uint32_t mask_words[LANES];
+    for (size_t k = 0; k < LANES; k++) {
+        mask_words[k] = (active >> k) & 1u ? UINT32_MAX : 0;
+    }
+    __m256i mask = _mm256_load_si256(reinterpret_cast<const __m256i *>(mask_words));
+    __m256i hash[8];
+    for (size_t i = 0; i < 8; i++) {
+        hash[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(state + i * LANES));
+    }
+    alignas(32) uint32_t words[16][LANES] = {};
+    for (size_t block = 0; block < n; block++) {
+        for (size_t k = 0; k < LANES; k++) {
+            if ((active >> k) & 1u) {
+                for (size_t i = 0; i < 16; i++) {
+                    words[i][k] = LoadBigEndian32(data[k] + block * 64 + i * 4);
+                }
+            }
+        }
+        __m256i w[16];
+        for (size_t i = 0; i < 16; i++) {
+            w[i] = _mm256_load_si256(reinterpret_cast<const __m256i *>(words[i]));
+        }
+        __m256i a = hash[0], b = hash[1], c = hash[2], d = hash[3];
+        __m256i e = hash[4], f = hash[5], g = hash[6], h = hash[7];
+        for (size_t t = 0; t < 64; t++) {
+            if (t >= 16) {
+                __m256i x = w[(t + 1) % 16], y = w[(t + 14) % 16];
+                __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(Sha256_Rotate256(x, 7), Sha256_Rotate256(x, 18)),
+                                              _mm256_srli_epi32(x, 3));
+                __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(Sha256_Rotate256(y, 17), Sha256_Rotate256(y, 19)),
+                                              _mm256_srli_epi32(y, 10));
+                w[t % 16] = _mm256_add_epi32(_mm256_add_epi32(w[t % 16], s0), _mm256_add_epi32(w[(t + 9) % 16], s1));
+            }
+            __m256i S1 = _mm256_xor_si256(_mm256_xor_si256(Sha256_Rotate256(e, 6), Sha256_Rotate256(e, 11)),
+                                          Sha256_Rotate256(e, 25));
+            __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+            __m256i temp1 = _mm256_add_epi32(_mm256_add_epi32(h, S1), _mm256_add_epi32(ch, w[t % 16]));
+            temp1 = _mm256_add_epi32(temp1, _mm256_set1_epi32(SHA256_K[t]));
+            __m256i S0 = _mm256_xor_si256(_mm256_xor_si256(Sha256_Rotate256(a, 2), Sha256_Rotate256(a, 13)),
+                                          Sha256_Rotate256(a, 22));
+            __m256i maj = _mm256_xor_si256(_mm256_and_si256(_mm256_xor_si256(a, b), c), _mm256_and_si256(a, b));
+            __m256i temp2 = _mm256_add_epi32(S0, maj);
+            h = g;
+            g = f;
+            f = e;
+            e = _mm256_add_epi32(d, temp1);
+            d = c;
+            c = b;
+            b = a;
+            a = _mm256_add_epi32(temp1, temp2);
+        }
+        __m256i result[8] = {a, b, c, d, e, f, g, h};
+        for (size_t i = 0; i < 8; i++) {
+            hash[i] = _mm256_add_epi32(hash[i], _mm256_and_si256(result[i], mask));
+        }
+    }
+    for (size_t i = 0; i < 8; i++) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(state + i * LANES), hash[i]);
+    }
+}
+
+// Three-way xor, choose and majority are single ternary-logic instructions on AVX-512. Rotates and shifts
+// use the full-mask maskz forms, the unmasked intrinsics trip -Wmaybe-uninitialized on GCC 12.
+__attribute__((target("avx512f"), always_inline))
+inline __m512i Sha256_Xor3(__m512i a, __m512i b, __m512i c) {
+    return _mm512_ternarylogic_epi32(a, b, c, 0x96);
+}
+
+__attribute__((target("avx512f")))
+void Sha256_BlocksAVX512(uint32_t *state, const uint8_t *const *data, size_t n, uint32_t active) {
+    const size_t LANES = 16;
+    __mmask16 mask = __mmask16(active);
+    __m512i hash[8];
+    for (size_t i = 0; i < 8; i++) {
+        hash[i] = _mm512_loadu_si512(state + i * LANES);
+    }
+    alignas(64) uint32_t words[16][LANES] = {};
+    for (size_t block = 0; block < n; block++) {
+        for (size_t k = 0; k < LANES; k++) {
+            if ((active >> k) & 1u) {
+                for (size_t i = 0; i < 16; i++) {
+                    words[i][k] = LoadBigEndian32(data[k] + block * 64 + i * 4);
+                }
+            }
+        }
+        __m512i w[16];
+        for (size_t i = 0; i < 16; i++) {
+            w[i] = _mm512_load_si512(words[i]);
+        }
+        __m512i a = hash[0], b = hash[1], c = hash[2], d = hash[3];
+        __m512i e = hash[4], f = hash[5], g = hash[6], h = hash[7];
+        for (size_t t = 0; t < 64; t++) {
+            if (t >= 16) {
+                __m512i x = w[(t + 1) % 16], y = w[(t + 14) % 16];
+                __m512i s0 = Sha256_Xor3(_mm512_maskz_ror_epi32(0xffff, x, 7), _mm512_maskz_ror_epi32(0xffff, x, 18),
+                                         _mm512_maskz_srli_epi32(0xffff, x, 3));
+                __m512i s1 = Sha256_Xor3(_mm512_maskz_ror_epi32(0xffff, y, 17), _mm512_maskz_ror_epi32(0xffff, y, 19),
+                                         _mm512_maskz_srli_epi32(0xffff, y, 10));
+                w[t % 16] = _mm512_add_epi32(_mm512_add_epi32(w[t % 16], s0), _mm512_add_epi32(w[(t + 9) % 16], s1));
+            }
+            __m512i S1 = Sha256_Xor3(_mm512_maskz_ror_epi32(0xffff, e, 6), _mm512_maskz_ror_epi32(0xffff, e, 11),
+                                     _mm512_maskz_ror_epi32(0xffff, e, 25));
+            __m512i ch = _mm512_ternarylogic_epi32(e, f, g, 0xca);
+            __m512i temp1 = _mm512_add_epi32(_mm512_add_epi32(h, S1), _mm512_add_epi32(ch, w[t % 16]));
+            temp1 = _mm512_add_epi32(temp1, _mm512_set1_epi32(SHA256_K[t]));
+            __m512i S0 = Sha256_Xor3(_mm512_maskz_ror_epi32(0xffff, a, 2), _mm512_maskz_ror_epi32(0xffff, a, 13),
+                                     _mm512_maskz_ror_epi32(0xffff, a, 22));
+            __m512i maj = _mm512_ternarylogic_epi32(a, b, c, 0xe8);
+            __m512i temp2 = _mm512_add_epi32(S0, maj);
+            h = g;
+            g = f;
+            f = e;
+            e = _mm512_add_epi32(d, temp1);
+            d = c;
+            c = b;
+            b = a;
+            a = _mm512_add_epi32(temp1, temp2);
+        }
+        __m512i result[8] = {a, b, c, d, e, f, g, h};
+        for (size_t i = 0; i < 8; i++) {
+            hash[i] = _mm512_mask_add_epi32(hash[i], mask, hash[i], result[i]);
+        }
+    }
+    for (size_t i = 0; i < 8; i++) {
+        _mm512_storeu_si512(state + i * LANES, hash[i]);
+    }
+}
+
+// Single-message compression with a vectorized message schedule: four words of the schedule are built
+// per vector, the last two of them depend on the first two through sigma1 so that term is added in two
+// halves. W + K lands in a buffer the scalar rounds read from.
+
+__attribute__((target("avx2"), always_inline))
+inline __m128i Sha256_ScheduleSigma(__m128i x, int r1, int r2, int shift) {
+    return _mm_xor_si128(_mm_xor_si128(Sha256_Rotate128(x, r1), Sha256_Rotate128(x, r2)), _mm_srli_epi32(x, shift));
+}
+
+__attribute__((always_inline))
+inline uint32_t Sha256_RotateRight(uint32_t x, int bits) {
+    return (x >> bits) | (x << (32 - bits));
+}
+
+__attribute__((target("avx2")))
+void Sha256_CompressAVX2(uint32_t *state, const uint8_t *data, size_t n) {
+    const __m128i BSWAP = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    alignas(16) uint32_t wk[64];
+    for (size_t block = 0; block < n; block++, data += 64) {
+        __m128i w[16];
+        for (size_t j = 0; j < 4; j++) {
+            w[j] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + j * 16)), BSWAP);
+        }
+        for (size_t j = 4; j < 16; j++) {
+            __m128i w15 = _mm_alignr_epi8(w[j - 3], w[j - 4], 4);
+            __m128i w7 = _mm_alignr_epi8(w[j - 1], w[j - 2], 4);
+            __m128i v = _mm_add_epi32(_mm_add_epi32(w[j - 4], Sha256_ScheduleSigma(w15, 7, 18, 3)), w7);
+            // W[t], W[t + 1] from W[t - 2], W[t - 1], then W[t + 2], W[t + 3] from those two
+            v = _mm_add_epi32(v, Sha256_ScheduleSigma(_mm_srli_si128(w[j - 1], 8), 17, 19, 10));
+            v = _mm_add_epi32(v, Sha256_ScheduleSigma(_mm_slli_si128(v, 8), 17, 19, 10));
+            w[j] = v;
+        }
+        for (size_t j = 0; j < 16; j++) {
+            __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i *>(SHA256_K + j * 4));
+            _mm_store_si128(reinterpret_cast<__m128i *>(wk + j * 4), _mm_add_epi32(w[j], k));
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (size_t i = 0; i < 64; i++) {
+            uint32_t S1 = Sha256_RotateRight(e, 6) ^ Sha256_RotateRight(e, 11) ^ Sha256_RotateRight(e, 25);
+            uint32_t temp1 = h + S1 + (g ^ (e & (f ^ g))) + wk[i];
+            uint32_t S0 = Sha256_RotateRight(a, 2) ^ Sha256_RotateRight(a, 13) ^ Sha256_RotateRight(a, 22);
+            uint32_t temp2 = S0 + ((a & b) | (c & (a | b)));
+            h = g;
+            g = f;
+            f = e;
+            e = d + temp1;
+            d = c;
+            c = b;
+            b = a;
+            a = temp1 + temp2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+#else
+
+// Only the portable engine is available on other architectures
+
+void Sha256_BlocksSSE2(uint32_t *state, const uint8_t *const *data, size_t n, uint32_t active) {}
+
+void Sha256_BlocksAVX2(uint32_t *state, const uint8_t *const *data, size_t n, uint32_t active) {}
+
+void Sha256_BlocksAVX512(uint32_t *state, const uint8_t *const *data, size_t n, uint32_t active) {}
+
+void Sha256_CompressAVX2(uint32_t *state, const uint8_t *data, size_t n) {}
+
+#endif
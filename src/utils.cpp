@@ -2,6 +2,10 @@
 #include <vector>
 #include <cassert>
 
+#ifdef CRYPTO330_X86
+#include <cpuid.h>
+#endif
+
 uint8_t mulX(uint8_t x, uint8_t poly) {
     return (x << 1u) ^ (((x >> 7u) & 1u) * poly);
 }
@@ -40,4 +44,40 @@ std::vector<uint8_t> HexStringToBytes(const std::string &str) {
 
 std::vector<uint8_t> StringToBytes(const std::string &str) {
     return std::vector<uint8_t>(str.begin(), str.end());
-}
\ No newline at end of file
+}
+
+CpuFeatures DetectCpuFeatures() {
+    CpuFeatures features;
+#ifdef CRYPTO330_X86
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        features.aes = (ecx & bit_AES) != 0;
+        features.ssse3 = (ecx & bit_SSSE3) != 0;
+        features.sse41 = (ecx & bit_SSE4_1) != 0;
+        features.pclmul = (ecx & bit_PCLMUL) != 0;
+        features.sse2 = (edx & bit_SSE2) != 0;
+
+        // The OS must save the YMM registers on context switches
+        bool ymm_enabled = false, zmm_enabled = false;
+        if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX)) {
+            uint32_t xcr0_low, xcr0_high;
+            __asm__("xgetbv" : "=a"(xcr0_low), "=d"(xcr0_high) : "c"(0));
+            ymm_enabled = (xcr0_low & 0x06u) == 0x06u;
+            zmm_enabled = (xcr0_low & 0xe6u) == 0xe6u;
+        }
+        if (ymm_enabled && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+            features.avx2 = (ebx & bit_AVX2) != 0;
+            features.avx512f = zmm_enabled && (ebx & bit_AVX512F) != 0;
+        }
+        if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+            features.sha = (ebx & bit_SHA) != 0;
+        }
+    }
+#endif
+    return features;
+}
+
+const CpuFeatures &GetCpuFeatures() {
+    static const CpuFeatures features = DetectCpuFeatures();
+    return features;
+}
@@ -0,0 +1,64 @@
+#include <crypto330/stream/xts.hpp>
+#include <crypto330/utils.hpp>
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+
+XtsEncryption::XtsEncryption(std::unique_ptr<BlockEncryption> &&encryption, std::unique_ptr<BlockEncryption> &&tweak)
+        : encryption(std::move(encryption)), tweak(std::move(tweak)) {
+    assert(this->encryption->GetBlockBytes() == 16 && this->tweak->GetBlockBytes() == 16);
+}
+
+void XtsEncryption::EncryptSector(uint8_t *data, size_t length, uint64_t sector) const {
+    ProcessSector(data, length, sector, true);
+}
+
+void XtsEncryption::DecryptSector(uint8_t *data, size_t length, uint64_t sector) const {
+    ProcessSector(data, length, sector, false);
+}
+
+void XtsEncryption::EncryptSectors(uint8_t *data, size_t sector_bytes, uint64_t first_sector, size_t count) const {
+    ProcessSectors(data, sector_bytes, first_sector, count, true);
+}
+
+void XtsEncryption::DecryptSectors(uint8_t *data, size_t sector_bytes, uint64_t first_sector, size_t count) const {
+    ProcessSectors(data, sector_bytes, first_sector, count, false);
+}
+
+void XtsEncryption::ProcessSectors(uint8_t *data, size_t sector_bytes, uint64_t first_sector, size_t count,
+                                   bool encrypt) const {
+#pragma omp parallel for if (count > 1)
+    for (size_t i = 0; i < count; i++) {
+        ProcessSector(data + i * sector_bytes, sector_bytes, first_sector + i, encrypt);
+    }
+}
+
+void XtsEncryption::ProcessSector(uint8_t *data, size_t length, uint64_t sector, bool encrypt) const {
+    assert(length > 0 && length % 16 == 0);
+    // Initial tweak is E(K2, sector) with the sector number as a 128-bit little-endian integer
+    uint64_t t[2] = {sector, 0};
+    tweak->EncryptBlock(reinterpret_cast<uint8_t *>(t));
+
+    // Tweaks for a batch are precomputed so the whole batch goes through EncryptBlocks at once
+    const size_t BATCH_BLOCKS = 256;
+    alignas(64) uint8_t tweaks[BATCH_BLOCKS * 16];
+    size_t blocks = length / 16;
+    for (size_t first = 0; first < blocks; first += BATCH_BLOCKS) {
+        size_t count = std::min(BATCH_BLOCKS, blocks - first);
+        for (size_t i = 0; i < count; i++) {
+            std::memcpy(tweaks + i * 16, t, 16);
+            // Multiply by alpha in GF(2^128) with x^128 = x^7 + x^2 + x + 1, little-endian bit order
+            uint64_t carry = t[1] >> 63u;
+            t[1] = (t[1] << 1u) | (t[0] >> 63u);
+            t[0] = (t[0] << 1u) ^ (carry * 0x87u);
+        }
+        uint8_t *blocks_data = data + first * 16;
+        XorBytes(blocks_data, tweaks, count * 16);
+        if (encrypt) {
+            encryption->EncryptBlocks(blocks_data, count);
+        } else {
+            encryption->DecryptBlocks(blocks_data, count);
+        }
+        XorBytes(blocks_data, tweaks, count * 16);
+    }
+}
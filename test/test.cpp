@@ -1,11 +1,17 @@
 #include <gtest/gtest.h>
 #include <crypto330/block/kalyna.hpp>
 #include <crypto330/utils.hpp>
+#include <crypto330/random.hpp>
 #include <crypto330/block/aes.hpp>
 #include <crypto330/stream/block_stream.hpp>
+#include <crypto330/stream/ghash.hpp>
+#include <crypto330/stream/xts.hpp>
 #include <crypto330/stream/rc4.hpp>
 #include <crypto330/stream/salsa.hpp>
+#include <crypto330/stream/chacha.hpp>
 #include <crypto330/hash/sha256.hpp>
+#include <crypto330/hash/kupyna.hpp>
+#include <crypto330/hash/hmac.hpp>
 #include <fstream>
 
 // Test data from original papers
@@ -84,6 +90,34 @@ TEST(Kalyna, Decryption) {
     EXPECT_EQ(data, expected);
 }
 
+TEST(Kalyna, BatchMatchesSingleBlock) {
+    std::vector<std::pair<Kalyna::Type, std::string>> types = {
+            {Kalyna::Type::K128_128, KEY128},
+            {Kalyna::Type::K256_128, KEY256},
+            {Kalyna::Type::K256_256, KEY256},
+            {Kalyna::Type::K512_256, KEY512},
+            {Kalyna::Type::K512_512, KEY512},
+    };
+    for (auto &[type, key] : types) {
+        Kalyna kalyna(type, key, true);
+        const BlockEncryption &cipher = kalyna;
+        uint64_t block_bytes = cipher.GetBlockBytes();
+        std::vector<uint8_t> data(block_bytes * 11);
+        for (size_t i = 0; i < data.size(); i++) {
+            data[i] = i * 13 + 5;
+        }
+        std::vector<uint8_t> expected = data;
+        for (size_t byte = 0; byte < expected.size(); byte += block_bytes) {
+            cipher.EncryptBlock(expected.data() + byte);
+        }
+        std::vector<uint8_t> actual = data;
+        cipher.EncryptBlocks(actual.data(), actual.size() / block_bytes);
+        EXPECT_EQ(actual, expected);
+        cipher.DecryptBlocks(actual.data(), actual.size() / block_bytes);
+        EXPECT_EQ(actual, data);
+    }
+}
+
 TEST(AES, Aes_128) {
     std::vector<uint8_t> data = HexStringToBytes("3243f6a8885a308d313198a2e0370734");
     std::vector<uint8_t> expected = HexStringToBytes("3925841d02dc09fbdc118597196a0b32");
@@ -104,6 +138,122 @@ TEST(AES, Decryption) {
     EXPECT_EQ(data, expected);
 }
 
+TEST(AES, Fips197_AllEngines) {
+    std::vector<uint8_t> plain = HexStringToBytes("00112233445566778899aabbccddeeff");
+    std::vector<std::pair<AES::Type, std::pair<std::string, std::string>>> vectors = {
+            {AES::Type::AES128, {KEY128, "69c4e0d86a7b0430d8cdb78070b4c55a"}},
+            {AES::Type::AES192, {KEY256.substr(0, 48), "dda97ca4864cdfe06eaf70a0ec0d7191"}},
+            {AES::Type::AES256, {KEY256, "8ea2b7ca516745bfeafc49904b496089"}},
+    };
+    std::vector<AES::Engine> engines = {AES::Engine::Reference, AES::Engine::TTable, AES::Engine::Bitsliced};
+    if (GetCpuFeatures().aes) {
+        engines.push_back(AES::Engine::AESNI);
+    }
+    for (auto engine : engines) {
+        for (auto &[type, key_and_expected] : vectors) {
+            AES aes(type, key_and_expected.first, true, engine);
+            std::vector<uint8_t> data = plain;
+            aes.Encrypt(data);
+            EXPECT_EQ(data, HexStringToBytes(key_and_expected.second));
+            aes.Decrypt(data);
+            EXPECT_EQ(data, plain);
+        }
+    }
+}
+
+TEST(AES, EnginesMatchReference) {
+    std::vector<uint8_t> data(16 * 97);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = i * 31 + 7;
+    }
+    std::vector<std::pair<AES::Type, std::string>> keys = {
+            {AES::Type::AES128, KEY128},
+            {AES::Type::AES192, KEY256.substr(0, 48)},
+            {AES::Type::AES256, KEY256},
+    };
+    for (auto &[type, key] : keys) {
+        AES reference(type, key, true, AES::Engine::Reference);
+        std::vector<uint8_t> expected = data;
+        reference.Encrypt(expected);
+        for (auto engine : {AES::Engine::TTable, AES::Engine::Bitsliced}) {
+            AES aes(type, key, true, engine);
+            EXPECT_EQ(aes.GetEngine(), engine);
+            std::vector<uint8_t> actual = data;
+            aes.Encrypt(actual);
+            EXPECT_EQ(actual, expected);
+            aes.Decrypt(actual);
+            EXPECT_EQ(actual, data);
+        }
+    }
+}
+
+TEST(AES, BatchMatchesSingleBlock) {
+    std::vector<uint8_t> data(16 * 21);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = i * 17 + 3;
+    }
+    for (auto engine : {AES::Engine::Reference, AES::Engine::TTable, AES::Engine::Auto, AES::Engine::Bitsliced}) {
+        AES aes(AES::Type::AES192, KEY256.substr(0, 48), true, engine);
+        const BlockEncryption &cipher = aes;
+        std::vector<uint8_t> expected = data;
+        for (size_t byte = 0; byte < expected.size(); byte += 16) {
+            cipher.EncryptBlock(expected.data() + byte);
+        }
+        std::vector<uint8_t> actual = data;
+        cipher.EncryptBlocks(actual.data(), actual.size() / 16);
+        EXPECT_EQ(actual, expected);
+        cipher.DecryptBlocks(actual.data(), actual.size() / 16);
+        EXPECT_EQ(actual, data);
+    }
+}
+
+std::vector<uint8_t> ReadWholeFile(const std::string &path) {
+    std::ifstream in(path, std::ios_base::binary);
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+TEST(AES, FileRoundTrip) {
+    std::vector<uint8_t> data(3 * 1024 * 1024 + 5);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = i * 7 + (i >> 11);
+    }
+    {
+        std::ofstream out("crypto330_plain.bin", std::ios_base::binary);
+        out.write(reinterpret_cast<const char *>(data.data()), data.size());
+    }
+
+    AES aes(AES::Type::AES128, AES_KEY_128, true);
+    const uint64_t CHUNK_BYTES = 1024 * 1024;
+    auto encrypted = aes.EncryptFile("crypto330_plain.bin", "crypto330_encrypted.bin", CHUNK_BYTES);
+    EXPECT_TRUE(encrypted.success);
+    EXPECT_EQ(encrypted.bytes, data.size());
+
+    BlockEncryption::FileHeader header{};
+    ASSERT_TRUE(BlockEncryption::ReadFileHeader("crypto330_encrypted.bin", header));
+    EXPECT_EQ(header.length, data.size());
+    EXPECT_EQ(header.cipher_id, aes.GetCipherId());
+    EXPECT_EQ(header.GetChunkCount(), 4);
+
+    auto decrypted = aes.DecryptFile("crypto330_encrypted.bin", "crypto330_decrypted.bin");
+    EXPECT_TRUE(decrypted.success);
+    EXPECT_EQ(ReadWholeFile("crypto330_decrypted.bin"), data);
+
+    // The middle chunk and the partial last chunk alone
+    EXPECT_TRUE(aes.DecryptFileChunks("crypto330_encrypted.bin", "crypto330_decrypted.bin", 1, 1).success);
+    EXPECT_EQ(ReadWholeFile("crypto330_decrypted.bin"),
+              std::vector<uint8_t>(data.begin() + CHUNK_BYTES, data.begin() + 2 * CHUNK_BYTES));
+    EXPECT_TRUE(aes.DecryptFileChunks("crypto330_encrypted.bin", "crypto330_decrypted.bin", 3, 10).success);
+    EXPECT_EQ(ReadWholeFile("crypto330_decrypted.bin"),
+              std::vector<uint8_t>(data.begin() + 3 * CHUNK_BYTES, data.end()));
+
+    Kalyna kalyna(Kalyna::Type::K128_128, KEY128, true);
+    EXPECT_FALSE(kalyna.DecryptFile("crypto330_encrypted.bin", "crypto330_decrypted.bin").success);
+
+    std::remove("crypto330_plain.bin");
+    std::remove("crypto330_encrypted.bin");
+    std::remove("crypto330_decrypted.bin");
+}
+
 TEST(Stream, ECB_AES) {
     std::vector<uint8_t> data = StringToBytes("Some random data, words, and other, !5$2552ASxv b\nf");
     std::vector<uint8_t> expected = data;
@@ -128,6 +278,351 @@ TEST(Stream, CBC_AES) {
     EXPECT_EQ(data, expected);
 }
 
+TEST(Stream, CBC_Sp800_38a) {
+    // F.2.2 CBC-AES128.Decrypt, the input is iv || ciphertext || 64-bit plaintext length
+    std::vector<uint8_t> data = HexStringToBytes("000102030405060708090a0b0c0d0e0f"
+                                                 "7649abac8119b246cee98e9b12e9197d5086cb9b507219ee95db113a917678b2"
+                                                 "73bed6b8e3c1743b7116e69e222295163ff1caa1681fac09120eca307586e1a7"
+                                                 "4000000000000000");
+    std::vector<uint8_t> expected = HexStringToBytes("6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+                                                     "30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710");
+    BlockStreamEncryption enc(std::make_unique<AES>(AES::Type::AES128, AES_KEY_128, true));
+    enc.Decrypt(data, BlockStreamEncryption::Mode::CBC);
+    EXPECT_EQ(data, expected);
+}
+
+TEST(Stream, CFB_OFB_Sp800_38a) {
+    // F.3.14 CFB128-AES128.Decrypt, F.3.8 CFB8-AES128.Decrypt and F.4.2 OFB-AES128.Decrypt,
+    // the input is ciphertext || iv
+    std::string iv = "000102030405060708090a0b0c0d0e0f";
+    std::vector<uint8_t> plaintext = HexStringToBytes("6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+                                                      "30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710");
+    std::vector<std::pair<BlockStreamEncryption::Mode, std::string>> tests = {
+            {BlockStreamEncryption::Mode::CFB, "3b3fd92eb72dad20333449f8e83cfb4ac8a64537a0b3a93fcde3cdad9f1ce58b"
+                                               "26751f67a3cbb140b1808cf187a4f4dfc04b05357c5d1c0eeac4c66f9ff7f2e6"},
+            {BlockStreamEncryption::Mode::CFB8, "3b79424c9c0dd436bace9e0ed4586a4f32b9"},
+            {BlockStreamEncryption::Mode::OFB, "3b3fd92eb72dad20333449f8e83cfb4a7789508d16918f03f53c52dac54ed825"
+                                               "9740051e9c5fecf64344f7a82260edcc304c6528f659c77866a510d9c1d6ae5e"},
+    };
+    BlockStreamEncryption enc(std::make_unique<AES>(AES::Type::AES128, AES_KEY_128, true));
+    for (auto &[mode, ciphertext] : tests) {
+        std::vector<uint8_t> data = HexStringToBytes(ciphertext + iv);
+        enc.Decrypt(data, mode);
+        EXPECT_EQ(data, std::vector<uint8_t>(plaintext.begin(), plaintext.begin() + data.size()));
+    }
+}
+
+TEST(Stream, LargeRoundTrip) {
+    // Several batches for the parallel paths, with a partial last block
+    std::vector<uint8_t> expected(100003);
+    for (size_t i = 0; i < expected.size(); i++) {
+        expected[i] = i * 29 + (i >> 8);
+    }
+    for (auto mode : {BlockStreamEncryption::Mode::ECB, BlockStreamEncryption::Mode::CBC,
+                      BlockStreamEncryption::Mode::CFB, BlockStreamEncryption::Mode::OFB,
+                      BlockStreamEncryption::Mode::CTR, BlockStreamEncryption::Mode::CFB8}) {
+        BlockStreamEncryption aes(std::make_unique<AES>(AES::Type::AES256, AES_KEY_256, true));
+        BlockStreamEncryption kalyna(std::make_unique<Kalyna>(Kalyna::Type::K512_512, KEY512, true));
+        for (auto *enc : {&aes, &kalyna}) {
+            std::vector<uint8_t> data = expected;
+            enc->Encrypt(data, mode);
+            enc->Decrypt(data, mode);
+            EXPECT_EQ(data, expected);
+        }
+    }
+}
+
+TEST(Stream, ContextChunks) {
+    // Arbitrary chunk sizes give the same output as a single Update
+    std::vector<uint8_t> plaintext(5000);
+    for (size_t i = 0; i < plaintext.size(); i++) {
+        plaintext[i] = i * 41 + (i >> 7);
+    }
+    std::vector<uint8_t> iv(32);
+    for (size_t i = 0; i < iv.size(); i++) {
+        iv[i] = i * 3 + 100;
+    }
+    std::vector<size_t> chunks = {1, 7, 16, 33, 2, 500, 31, 64, 1000};
+    BlockStreamEncryption aes(std::make_unique<AES>(AES::Type::AES128, AES_KEY_128, true));
+    BlockStreamEncryption kalyna(std::make_unique<Kalyna>(Kalyna::Type::K256_256, KEY256, true));
+    for (auto *enc : {&aes, &kalyna}) {
+        for (auto mode : {BlockStreamEncryption::Mode::ECB, BlockStreamEncryption::Mode::CBC,
+                          BlockStreamEncryption::Mode::CFB, BlockStreamEncryption::Mode::CFB8,
+                          BlockStreamEncryption::Mode::OFB, BlockStreamEncryption::Mode::CTR}) {
+            std::vector<uint8_t> expected(plaintext.size() + 64);
+            BlockStreamEncryption::Context whole(*enc, mode, true);
+            whole.Init(iv.data());
+            size_t size = whole.Update(plaintext.data(), expected.data(), plaintext.size());
+            size += whole.Final(expected.data() + size);
+            expected.resize(size);
+
+            // Chunked and out of place
+            std::vector<uint8_t> encrypted(plaintext.size() + 64);
+            BlockStreamEncryption::Context context(*enc, mode, true);
+            context.Init(iv.data());
+            size_t in = 0, out = 0;
+            for (size_t i = 0; in < plaintext.size(); i++) {
+                size_t length = std::min(chunks[i % chunks.size()], plaintext.size() - in);
+                out += context.Update(plaintext.data() + in, encrypted.data() + out, length);
+                in += length;
+            }
+            out += context.Final(encrypted.data() + out);
+            encrypted.resize(out);
+            EXPECT_EQ(encrypted, expected);
+
+            // Chunked and in place
+            std::vector<uint8_t> decrypted = encrypted;
+            decrypted.resize(decrypted.size() + 64);
+            BlockStreamEncryption::Context decryption(*enc, mode, false);
+            decryption.Init(iv.data());
+            in = 0, out = 0;
+            for (size_t i = 3; in < encrypted.size(); i++) {
+                size_t length = std::min(chunks[i % chunks.size()], encrypted.size() - in);
+                out += decryption.Update(decrypted.data() + in, decrypted.data() + out, length);
+                in += length;
+            }
+            out += decryption.Final(decrypted.data() + out);
+            decrypted.resize(plaintext.size());
+            EXPECT_EQ(decrypted, plaintext);
+        }
+    }
+}
+
+TEST(Stream, OutOfPlace) {
+    std::vector<uint8_t> plaintext = StringToBytes("Out of place data that is not a multiple of the block size!");
+    AES aes(AES::Type::AES128, AES_KEY_128, true);
+    std::vector<uint8_t> blocks(aes.GetPaddedSize(plaintext.size()));
+    EXPECT_EQ(aes.Encrypt(plaintext.data(), plaintext.size(), blocks.data(), blocks.size()), blocks.size());
+    std::vector<uint8_t> expected = plaintext;
+    aes.Encrypt(expected);
+    EXPECT_EQ(blocks, expected);
+    std::vector<uint8_t> decrypted(blocks.size());
+    EXPECT_EQ(aes.Decrypt(blocks.data(), blocks.size(), decrypted.data(), decrypted.size()), blocks.size());
+    decrypted.resize(plaintext.size());
+    EXPECT_EQ(decrypted, plaintext);
+    // Too small an output buffer is rejected without writing
+    EXPECT_EQ(aes.Encrypt(plaintext.data(), plaintext.size(), decrypted.data(), plaintext.size()), 0);
+    EXPECT_EQ(aes.Decrypt(blocks.data(), blocks.size(), decrypted.data(), blocks.size() - 16), 0);
+    EXPECT_EQ(decrypted, plaintext);
+
+    BlockStreamEncryption enc(std::make_unique<AES>(AES::Type::AES128, AES_KEY_128, true));
+    for (auto mode : {BlockStreamEncryption::Mode::ECB, BlockStreamEncryption::Mode::CBC,
+                      BlockStreamEncryption::Mode::CFB, BlockStreamEncryption::Mode::CFB8,
+                      BlockStreamEncryption::Mode::OFB, BlockStreamEncryption::Mode::CTR}) {
+        std::vector<uint8_t> encrypted(enc.GetEncryptedSize(plaintext.size(), mode));
+        EXPECT_EQ(enc.Encrypt(plaintext.data(), plaintext.size(), encrypted.data(), encrypted.size(), mode),
+                  encrypted.size());
+        std::vector<uint8_t> result(encrypted.size());
+        size_t size = enc.Decrypt(encrypted.data(), encrypted.size(), result.data(), result.size(), mode);
+        result.resize(size);
+        EXPECT_EQ(result, plaintext);
+        EXPECT_EQ(enc.Encrypt(plaintext.data(), plaintext.size(), result.data(), plaintext.size() - 1, mode), 0);
+        EXPECT_EQ(enc.Decrypt(encrypted.data(), encrypted.size(), result.data(), encrypted.size() - 1, mode), 0);
+        enc.Decrypt(encrypted, mode);
+        EXPECT_EQ(encrypted, plaintext);
+    }
+
+    RC4 rc4("Cool RC4 Key");
+    Salsa salsa("Cool Salsa Key");
+    std::vector<uint8_t> rc4_vector = plaintext, salsa_vector = plaintext;
+    rc4.Encrypt(rc4_vector);
+    salsa.Encrypt(salsa_vector);
+    std::vector<uint8_t> rc4_out(plaintext.size()), salsa_out(plaintext.size());
+    rc4.Encrypt(plaintext.data(), rc4_out.data(), plaintext.size());
+    salsa.Encrypt(plaintext.data(), salsa_out.data(), plaintext.size());
+    EXPECT_EQ(rc4_out, rc4_vector);
+    EXPECT_EQ(salsa_out, salsa_vector);
+}
+
+TEST(Stream, GCM_TestVectors) {
+    // Test cases 1-4 of the GCM specification (McGrew, Viega)
+    struct TestCase {
+        std::string key, iv, plaintext, aad, ciphertext, tag;
+    };
+    std::string plaintext = "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a72"
+                            "1c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b391aafd255";
+    std::string ciphertext = "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e"
+                             "21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091473f5985";
+    std::vector<TestCase> tests = {
+            {"00000000000000000000000000000000", "000000000000000000000000", "", "", "",
+             "58e2fccefa7e3061367f1d57a4e7455a"},
+            {"00000000000000000000000000000000", "000000000000000000000000", "00000000000000000000000000000000", "",
+             "0388dace60b6a392f328c2b971b2fe78", "ab6e47d42cec13bdf53a67b21257bddf"},
+            {"feffe9928665731c6d6a8f9467308308", "cafebabefacedbaddecaf888", plaintext, "", ciphertext,
+             "4d5c2af327cd64a62cf35abd2ba6fab4"},
+            {"feffe9928665731c6d6a8f9467308308", "cafebabefacedbaddecaf888", plaintext.substr(0, 120),
+             "feedfacedeadbeeffeedfacedeadbeefabaddad2", ciphertext.substr(0, 120),
+             "5bc94fbc3221a5db94fae95ae7121a47"},
+    };
+    for (auto &test : tests) {
+        BlockStreamEncryption enc(std::make_unique<AES>(AES::Type::AES128, test.key, true));
+        auto iv = HexStringToBytes(test.iv);
+        auto data = HexStringToBytes(test.plaintext);
+        auto aad = HexStringToBytes(test.aad);
+        std::vector<uint8_t> tag(BlockStreamEncryption::GCM_TAG_BYTES);
+        enc.EncryptGCM(iv.data(), aad.data(), aad.size(), data.data(), data.data(), data.size(), tag.data());
+        EXPECT_EQ(data, HexStringToBytes(test.ciphertext));
+        EXPECT_EQ(tag, HexStringToBytes(test.tag));
+
+        EXPECT_TRUE(enc.DecryptGCM(iv.data(), aad.data(), aad.size(), data.data(), data.data(), data.size(),
+                                   tag.data()));
+        EXPECT_EQ(data, HexStringToBytes(test.plaintext));
+    }
+}
+
+TEST(Stream, GCM_RoundTrip) {
+    std::vector<uint8_t> expected(100005);
+    for (size_t i = 0; i < expected.size(); i++) {
+        expected[i] = i * 17 + (i >> 10);
+    }
+    BlockStreamEncryption enc(std::make_unique<AES>(AES::Type::AES256, AES_KEY_256, true));
+    std::vector<uint8_t> data = expected;
+    enc.Encrypt(data, BlockStreamEncryption::Mode::GCM);
+    EXPECT_EQ(data.size(), enc.GetEncryptedSize(expected.size(), BlockStreamEncryption::Mode::GCM));
+    std::vector<uint8_t> tampered = data;
+    EXPECT_TRUE(enc.Decrypt(data, BlockStreamEncryption::Mode::GCM));
+    EXPECT_EQ(data, expected);
+
+    tampered[1234] ^= 1;
+    EXPECT_FALSE(enc.Decrypt(tampered, BlockStreamEncryption::Mode::GCM));
+    EXPECT_TRUE(tampered.empty());
+
+    // Shorter than iv || tag
+    std::vector<uint8_t> truncated(BlockStreamEncryption::GCM_IV_BYTES + BlockStreamEncryption::GCM_TAG_BYTES - 1);
+    EXPECT_FALSE(enc.Decrypt(truncated, BlockStreamEncryption::Mode::GCM));
+    EXPECT_TRUE(truncated.empty());
+}
+
+TEST(Stream, CTR_HMAC_RoundTrip) {
+    std::vector<uint8_t> expected(200003);
+    for (size_t i = 0; i < expected.size(); i++) {
+        expected[i] = i * 13 + (i >> 9);
+    }
+    std::vector<BlockStreamEncryption> encryptions;
+    encryptions.emplace_back(std::make_unique<AES>(AES::Type::AES128, AES_KEY_128, true),
+                             std::make_unique<Sha256>(), "mac key");
+    encryptions.emplace_back(std::make_unique<Kalyna>(Kalyna::Type::K512_512, KEY512, true),
+                             std::make_unique<Kupyna>(Kupyna::Size::Kupyna512), "mac key");
+    for (auto &enc : encryptions) {
+        std::vector<uint8_t> data = expected;
+        enc.Encrypt(data, BlockStreamEncryption::Mode::CTR_HMAC);
+        EXPECT_EQ(data.size(), enc.GetEncryptedSize(expected.size(), BlockStreamEncryption::Mode::CTR_HMAC));
+        std::vector<uint8_t> tampered = data;
+        EXPECT_TRUE(enc.Decrypt(data, BlockStreamEncryption::Mode::CTR_HMAC));
+        EXPECT_EQ(data, expected);
+
+        tampered[150000] ^= 1;
+        EXPECT_FALSE(enc.Decrypt(tampered, BlockStreamEncryption::Mode::CTR_HMAC));
+        EXPECT_TRUE(tampered.empty());
+
+        // Shorter than iv || tag
+        std::vector<uint8_t> truncated(enc.GetEncryptedSize(0, BlockStreamEncryption::Mode::CTR_HMAC) - 1);
+        EXPECT_FALSE(enc.Decrypt(truncated, BlockStreamEncryption::Mode::CTR_HMAC));
+        EXPECT_TRUE(truncated.empty());
+    }
+
+    // Constructed without a MAC
+    BlockStreamEncryption plain(std::make_unique<AES>(AES::Type::AES128, AES_KEY_128, true));
+    std::vector<uint8_t> data = expected;
+    plain.Encrypt(data, BlockStreamEncryption::Mode::CTR_HMAC);
+    EXPECT_TRUE(data.empty());
+    data = expected;
+    EXPECT_FALSE(plain.Decrypt(data, BlockStreamEncryption::Mode::CTR_HMAC));
+}
+
+TEST(Stream, XTS_Ieee1619) {
+    std::string zero_key = "00000000000000000000000000000000";
+    XtsEncryption zero(std::make_unique<AES>(AES::Type::AES128, zero_key, true),
+                       std::make_unique<AES>(AES::Type::AES128, zero_key, true));
+    std::vector<uint8_t> data(32, 0);
+    zero.EncryptSector(data.data(), data.size(), 0);
+    EXPECT_EQ(data, HexStringToBytes("917cf69ebd68b2ec9b9fe9a3eadda692cd43d2f59598ed858c02c2652fbf922e"));
+
+    XtsEncryption xts(std::make_unique<AES>(AES::Type::AES128, "11111111111111111111111111111111", true),
+                      std::make_unique<AES>(AES::Type::AES128, "22222222222222222222222222222222", true));
+    data.assign(32, 0x44);
+    xts.EncryptSector(data.data(), data.size(), 0x3333333333);
+    EXPECT_EQ(data, HexStringToBytes("c454185e6a16936e39334038acef838bfb186fff7480adc4289382ecd6d394f0"));
+    xts.DecryptSector(data.data(), data.size(), 0x3333333333);
+    EXPECT_EQ(data, std::vector<uint8_t>(32, 0x44));
+}
+
+TEST(Stream, XTS_Sectors) {
+    const size_t SECTOR_BYTES = 4096;
+    std::vector<uint8_t> expected(SECTOR_BYTES * 37);
+    for (size_t i = 0; i < expected.size(); i++) {
+        expected[i] = i * 29 + (i >> 12);
+    }
+    XtsEncryption xts(std::make_unique<Kalyna>(Kalyna::Type::K128_128, KEY128, true),
+                      std::make_unique<Kalyna>(Kalyna::Type::K256_128, KEY256, true));
+    std::vector<uint8_t> data = expected;
+    xts.EncryptSectors(data.data(), SECTOR_BYTES, 100, 37);
+    EXPECT_NE(data, expected);
+
+    // A batch matches sector-by-sector encryption and any sector decrypts on its own
+    std::vector<uint8_t> sector(expected.begin() + 5 * SECTOR_BYTES, expected.begin() + 6 * SECTOR_BYTES);
+    xts.EncryptSector(sector.data(), SECTOR_BYTES, 105);
+    EXPECT_TRUE(std::equal(sector.begin(), sector.end(), data.begin() + 5 * SECTOR_BYTES));
+    xts.DecryptSector(sector.data(), SECTOR_BYTES, 105);
+    EXPECT_TRUE(std::equal(sector.begin(), sector.end(), expected.begin() + 5 * SECTOR_BYTES));
+
+    xts.DecryptSectors(data.data(), SECTOR_BYTES, 100, 37);
+    EXPECT_EQ(data, expected);
+}
+
+TEST(Stream, CTR_HMAC_KnownAnswer) {
+    // Kalyna-512 CTR with an HMAC-Kupyna-512 tag: ciphertext || iv || tag
+    std::vector<uint8_t> ciphertext = HexStringToBytes("7d5bb6f65c72c64acb862b8559e1cdbb5db9847149d5c988fa6a0f5ae1bcecb3"
+                                                       "a4ce180e2766e3e116d268862529f6048fbd49ecd576e378195e97b98c67501c"
+                                                       "1c7d5e825e6e13f8846e36bf1d47f011500de0221a5089f06b137b7a833afd1c"
+                                                       "3ef074ef");
+    std::vector<uint8_t> iv = HexStringToBytes("c1be22e3fadb9175db9978f8d6d3e781c0b5fad2fd5ba7e6d009946960c2c3be"
+                                               "5593e10afb73a68b43d88b6637ebc9fc9b738e88c0275d576649a4155feca7c3");
+    std::vector<uint8_t> tag = HexStringToBytes("80fbc2b45a23727a90719261513f9cd9589bb749467b8076fdb5c20676ced6dd"
+                                                "8704cb8d1585fbb52934eb268c7ece1c97058718e3efc91dc1817afcaca7600f");
+    std::vector<uint8_t> expected(100);
+    for (size_t i = 0; i < expected.size(); i++) {
+        expected[i] = i * 13 + 1;
+    }
+
+    // One tile, so the tag is HMAC(iv || Kupyna(ciphertext) || 64-bit length)
+    Kupyna kupyna(Kupyna::Size::Kupyna512);
+    std::vector<uint8_t> message = iv;
+    std::vector<uint8_t> digest = kupyna.GetHash(ciphertext);
+    message.insert(message.end(), digest.begin(), digest.end());
+    message.resize(message.size() + 8);
+    message[message.size() - 8] = expected.size();
+    EXPECT_EQ(Hmac(kupyna, StringToBytes("mac key"), message), tag);
+
+    BlockStreamEncryption enc(std::make_unique<Kalyna>(Kalyna::Type::K512_512, KEY512, true),
+                              std::make_unique<Kupyna>(Kupyna::Size::Kupyna512), "mac key");
+    std::vector<uint8_t> data = ciphertext;
+    data.insert(data.end(), iv.begin(), iv.end());
+    data.insert(data.end(), tag.begin(), tag.end());
+    EXPECT_TRUE(enc.Decrypt(data, BlockStreamEncryption::Mode::CTR_HMAC));
+    EXPECT_EQ(data, expected);
+}
+
+TEST(Stream, GHash_ClmulMatchesTable) {
+    if (!GetCpuFeatures().pclmul) {
+        return;
+    }
+    std::vector<uint8_t> h = HexStringToBytes("66e94bd4ef8a2c3b884cfa59ca342b2e");
+    std::vector<uint8_t> data(1000);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = i * 7 + 3;
+    }
+    for (size_t length : {0, 5, 16, 48, 64, 80, 1000}) {
+        GHash table(h.data(), false), clmul(h.data(), true);
+        table.Update(data.data(), length);
+        clmul.Update(data.data(), length);
+        std::vector<uint8_t> table_digest(16), clmul_digest(16);
+        table.Final(7, length, table_digest.data());
+        clmul.Final(7, length, clmul_digest.data());
+        EXPECT_EQ(table_digest, clmul_digest);
+    }
+}
+
 TEST(Stream, OFB_AES) {
     std::vector<uint8_t> data = StringToBytes("XX Some random data, words, and other, !5$2552ASxv b\nf");
     std::vector<uint8_t> expected = data;
@@ -154,6 +649,77 @@ TEST(Stream, CTR_AES) {
     EXPECT_EQ(data, expected);
 }
 
+TEST(Stream, CTR_Sp800_38a) {
+    // F.5.1 CTR-AES128.Encrypt, decryption of plaintext || counter block gives the ciphertext
+    std::vector<uint8_t> data = HexStringToBytes("6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+                                                 "30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710"
+                                                 "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff");
+    std::vector<uint8_t> expected = HexStringToBytes("874d6191b620e3261bef6864990db6ce9806f66b7970fdff8617187bb9fffdff"
+                                                     "5ae4df3edbd5d35e5b4f09020db03eab1e031dda2fbe03d1792170a0f3009cee");
+    BlockStreamEncryption enc(std::make_unique<AES>(AES::Type::AES128, AES_KEY_128, true));
+    enc.Decrypt(data, BlockStreamEncryption::Mode::CTR);
+    EXPECT_EQ(data, expected);
+}
+
+TEST(Stream, CTR_CounterCarry) {
+    // The counter carries from the low 64 bits into the high 64 bits
+    std::vector<uint8_t> data(32 + 16, 0);
+    std::fill(data.end() - 8, data.end(), 0xff);
+    BlockStreamEncryption enc(std::make_unique<AES>(AES::Type::AES128, AES_KEY_128, true));
+    enc.Decrypt(data, BlockStreamEncryption::Mode::CTR);
+
+    AES aes(AES::Type::AES128, AES_KEY_128, true);
+    const BlockEncryption &cipher = aes;
+    std::vector<uint8_t> counter(16, 0);
+    counter[7] = 1;
+    cipher.EncryptBlock(counter.data());
+    EXPECT_EQ(std::vector<uint8_t>(data.begin() + 16, data.end()), counter);
+}
+
+TEST(Stream, CTR_Range) {
+    std::vector<uint8_t> data(10000);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = i * 13 + 1;
+    }
+    std::vector<uint8_t> encrypted = data;
+    BlockStreamEncryption enc(std::make_unique<AES>(AES::Type::AES128, AES_KEY_128, true));
+    enc.Encrypt(encrypted, BlockStreamEncryption::Mode::CTR);
+
+    for (uint64_t offset : {0, 1, 15, 16, 17, 1000, 5001}) {
+        for (uint64_t length : {0, 1, 16, 33, 1024, 4999}) {
+            EXPECT_EQ(enc.DecryptRangeCTR(encrypted, offset, length),
+                      std::vector<uint8_t>(data.begin() + offset, data.begin() + offset + length));
+        }
+    }
+    EXPECT_EQ(enc.DecryptRangeCTR(encrypted, 9990, 100), std::vector<uint8_t>(data.end() - 10, data.end()));
+}
+
+TEST(Stream, CTR_FileRange) {
+    std::vector<uint8_t> data(1000003);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = i * 13 + (i >> 9);
+    }
+    {
+        std::ofstream out("crypto330_plain.bin", std::ios_base::binary);
+        out.write(reinterpret_cast<const char *>(data.data()), data.size());
+    }
+    BlockStreamEncryption enc(std::make_unique<Kalyna>(Kalyna::Type::K256_256, KEY256, true));
+    EXPECT_TRUE(enc.EncryptFileCTR("crypto330_plain.bin", "crypto330_encrypted.bin").success);
+
+    std::vector<uint8_t> range;
+    EXPECT_TRUE(enc.DecryptFileRangeCTR("crypto330_encrypted.bin", 654321, 1234, range));
+    EXPECT_EQ(range, std::vector<uint8_t>(data.begin() + 654321, data.begin() + 654321 + 1234));
+    EXPECT_TRUE(enc.DecryptFileRangeCTR("crypto330_encrypted.bin", 999999, 100, range));
+    EXPECT_EQ(range, std::vector<uint8_t>(data.end() - 4, data.end()));
+
+    EXPECT_TRUE(enc.DecryptFileCTR("crypto330_encrypted.bin", "crypto330_decrypted.bin").success);
+    EXPECT_EQ(ReadWholeFile("crypto330_decrypted.bin"), data);
+
+    std::remove("crypto330_plain.bin");
+    std::remove("crypto330_encrypted.bin");
+    std::remove("crypto330_decrypted.bin");
+}
+
 TEST(Stream, CFB_AES) {
     std::vector<uint8_t> data = StringToBytes("XX Some random data, words, and other, !5$2552ASxv b\nf");
     std::vector<uint8_t> expected = data;
@@ -180,6 +746,48 @@ TEST(Stream, RC4) {
     EXPECT_EQ(data, expected);
 }
 
+TEST(Stream, RC4_KnownAnswer) {
+    RC4 rc4("Secret");
+    std::vector<uint8_t> data = StringToBytes("Attack at dawn");
+    rc4.Encrypt(data);
+    EXPECT_EQ(data, HexStringToBytes("45a01f645fc35b383552544b9bf5"));
+}
+
+TEST(Stream, RC4_StreamAndBatch) {
+    RC4 rc4("Cool RC4 Key");
+    std::vector<uint8_t> expected(5000);
+    rc4.Encrypt(expected);
+
+    // Consecutive updates continue the keystream
+    RC4::Stream stream(rc4);
+    std::vector<uint8_t> data(expected.size());
+    for (size_t offset = 0, chunk = 1; offset < data.size(); offset += chunk, chunk = chunk * 3 + 1) {
+        chunk = std::min(chunk, data.size() - offset);
+        stream.Update(data.data() + offset, data.data() + offset, chunk);
+    }
+    EXPECT_EQ(data, expected);
+
+    // Messages of different lengths, including empty ones, under two keys
+    RC4 other("Another RC4 Key");
+    std::vector<std::vector<uint8_t>> messages, outputs;
+    std::vector<RC4::Stream> streams;
+    for (size_t i = 0; i < 23; i++) {
+        messages.emplace_back((i * 37) % 300, uint8_t(i));
+        outputs.emplace_back(messages.back().size());
+        streams.emplace_back(i % 3 ? rc4 : other);
+    }
+    std::vector<RC4::Job> jobs;
+    for (size_t i = 0; i < messages.size(); i++) {
+        jobs.push_back({&streams[i], messages[i].data(), outputs[i].data(), messages[i].size()});
+    }
+    RC4::UpdateBatch(jobs.data(), jobs.size());
+    for (size_t i = 0; i < messages.size(); i++) {
+        std::vector<uint8_t> single = messages[i];
+        (i % 3 ? rc4 : other).Encrypt(single);
+        EXPECT_EQ(outputs[i], single);
+    }
+}
+
 TEST(Stream, Salsa) {
     std::vector<uint8_t> data = StringToBytes("XX Some random data, words, and other, !5$2552ASxv b\nf");
     std::vector<uint8_t> expected = data;
@@ -193,6 +801,162 @@ TEST(Stream, Salsa) {
     EXPECT_EQ(data, expected);
 }
 
+TEST(Stream, Salsa_Estream) {
+    // eSTREAM Set 1, vector 0 for 128- and 256-bit keys, first 64 bytes of keystream
+    std::vector<std::pair<std::string, std::string>> tests = {
+            {"80000000000000000000000000000000",
+             "4dfa5e481da23ea09a31022050859936da52fcee218005164f267cb65f5cfd7f"
+             "2b4f97e0ff16924a52df269515110a07f9e460bc65ef95da58f740b7d1dbb0aa"},
+            {"8000000000000000000000000000000000000000000000000000000000000000",
+             "e3be8fdd8beca2e3ea8ef9475b29a6e7003951e1097a5c38d23b7a5fad9f6844"
+             "b22c97559e2723c7cbbd3fe4fc8d9a0744652a83e72a9c461876af4d7ef1a117"},
+    };
+    for (auto &[key, expected] : tests) {
+        Salsa salsa(key, true, std::vector<uint8_t>(8, 0));
+        std::vector<uint8_t> data(64, 0);
+        salsa.Encrypt(data);
+        EXPECT_EQ(data, HexStringToBytes(expected));
+    }
+}
+
+std::vector<KeystreamCipher::Engine> GetKeystreamEngines() {
+    std::vector<KeystreamCipher::Engine> engines = {KeystreamCipher::Engine::Portable};
+    if (GetCpuFeatures().sse2) {
+        engines.push_back(KeystreamCipher::Engine::SSE2);
+    }
+    if (GetCpuFeatures().avx2) {
+        engines.push_back(KeystreamCipher::Engine::AVX2);
+    }
+    if (GetCpuFeatures().avx512f) {
+        engines.push_back(KeystreamCipher::Engine::AVX512);
+    }
+    return engines;
+}
+
+TEST(Stream, Salsa_EnginesAndSeek) {
+    std::vector<uint8_t> nonce = HexStringToBytes("0102030405060708");
+    std::vector<KeystreamCipher::Engine> engines = GetKeystreamEngines();
+    std::vector<uint8_t> expected(100003);
+    Salsa(KEY256, true, nonce, KeystreamCipher::Engine::Portable).Encrypt(expected);
+    for (auto engine : engines) {
+        Salsa salsa(KEY256, true, nonce, engine);
+        std::vector<uint8_t> data(expected.size());
+        salsa.Encrypt(data);
+        EXPECT_EQ(data, expected);
+
+        // Starting at any offset gives the same bytes as processing from the beginning
+        for (size_t offset : {1, 64, 700, 99000}) {
+            std::vector<uint8_t> part(expected.size() - offset);
+            salsa.Encrypt(part.data(), part.data(), part.size(), offset);
+            EXPECT_TRUE(std::equal(part.begin(), part.end(), expected.begin() + offset));
+        }
+    }
+
+    // The block counter carries into its high word inside a group of vector lanes
+    Salsa salsa(KEY256, true, nonce);
+    std::vector<uint8_t> carry(2048), blocks(2048);
+    salsa.Encrypt(carry.data(), carry.data(), carry.size(), (0x100000000ull - 4) * 64);
+    Salsa(KEY256, true, nonce, KeystreamCipher::Engine::Portable)
+            .GenerateKeystream(0x100000000ull - 4, blocks.data(), 32);
+    EXPECT_EQ(carry, blocks);
+}
+
+TEST(Stream, ChaCha20_Rfc8439) {
+    std::string key = "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f";
+    // 2.3.2, block function with counter 1
+    std::vector<uint8_t> block(64);
+    ChaCha20(key, true, HexStringToBytes("000000090000004a00000000")).GenerateKeystream(1, block.data(), 1);
+    EXPECT_EQ(block, HexStringToBytes("10f1e7e4d13b5915500fdd1fa32071c4c7d1f4c733c068030422aa9ac3d46c4e"
+                                      "d2826446079faa0914c2d705d98b02a2b5129cd1de164eb9cbd083e8a2503c4e"));
+
+    // 2.4.2, encryption starting at counter 1
+    std::vector<uint8_t> data = StringToBytes("Ladies and Gentlemen of the class of '99: If I could offer you only "
+                                              "one tip for the future, sunscreen would be it.");
+    std::vector<uint8_t> expected = HexStringToBytes(
+            "6e2e359a2568f98041ba0728dd0d6981e97e7aec1d4360c20a27afccfd9fae0bf91b65c5524733ab8f593dabcd62b357"
+            "1639d624e65152ab8f530c359f0861d807ca0dbf500d6a6156a38e088a22b65e52bc514d16ccf806818ce91ab7793736"
+            "5af90bbf74a35be6b40b8eedf2785e42874d");
+    for (auto engine : GetKeystreamEngines()) {
+        ChaCha20 chacha(key, true, HexStringToBytes("000000000000004a00000000"), engine);
+        std::vector<uint8_t> out(data.size());
+        chacha.Encrypt(data.data(), out.data(), data.size(), 64);
+        EXPECT_EQ(out, expected);
+    }
+}
+
+TEST(Stream, ChaCha20_EnginesAndSeek) {
+    std::vector<uint8_t> expected(100003);
+    ChaCha20(KEY256, true, HexStringToBytes("0102030405060708090a0b0c"), KeystreamCipher::Engine::Portable)
+            .Encrypt(expected);
+    for (auto engine : GetKeystreamEngines()) {
+        ChaCha20 chacha(KEY256, true, HexStringToBytes("0102030405060708090a0b0c"), engine);
+        std::vector<uint8_t> data(expected.size());
+        chacha.Encrypt(data);
+        EXPECT_EQ(data, expected);
+        for (size_t offset : {3, 128, 5000, 99000}) {
+            std::vector<uint8_t> part(expected.size() - offset);
+            chacha.Encrypt(part.data(), part.data(), part.size(), offset);
+            EXPECT_TRUE(std::equal(part.begin(), part.end(), expected.begin() + offset));
+        }
+
+        // With an 8-byte nonce the counter carries into word 13
+        ChaCha20 wide(KEY256, true, HexStringToBytes("0102030405060708"), engine);
+        std::vector<uint8_t> carry(2048), blocks(2048);
+        wide.Encrypt(carry.data(), carry.data(), carry.size(), (0x100000000ull - 4) * 64);
+        ChaCha20(KEY256, true, HexStringToBytes("0102030405060708"), KeystreamCipher::Engine::Portable)
+                .GenerateKeystream(0x100000000ull - 4, blocks.data(), 32);
+        EXPECT_EQ(carry, blocks);
+    }
+}
+
+TEST(Stream, XChaCha20) {
+    // HChaCha20 test vector of the XChaCha draft, section 2.2.1
+    std::string key_hex = "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f";
+    std::vector<uint8_t> key = HexStringToBytes(key_hex);
+    std::vector<uint8_t> nonce = HexStringToBytes("000000090000004a0000000031415927");
+    std::vector<uint8_t> subkey(32);
+    HChaCha20(key.data(), nonce.data(), subkey.data());
+    EXPECT_EQ(subkey, HexStringToBytes("82413b4227b27bfed30e42508a877d73a0f9e4d58a74a853c12ec41326d3ecdc"));
+
+    // XChaCha20 is ChaCha20 under the subkey with the last 8 nonce bytes
+    std::vector<uint8_t> long_nonce = nonce;
+    std::vector<uint8_t> tail = HexStringToBytes("0102030405060708");
+    long_nonce.insert(long_nonce.end(), tail.begin(), tail.end());
+    std::string subkey_hex = "82413b4227b27bfed30e42508a877d73a0f9e4d58a74a853c12ec41326d3ecdc";
+    std::vector<uint8_t> data(1000), expected(1000);
+    XChaCha20(key_hex, true, long_nonce).Encrypt(data);
+    ChaCha20(subkey_hex, true, tail).Encrypt(expected);
+    EXPECT_EQ(data, expected);
+}
+
+TEST(Random, Bytes) {
+    // Small requests come from the pool, large ones are generated in place
+    for (size_t size : {16, 1000, 100000}) {
+        std::vector<uint8_t> a = RandomBytes(size), b = RandomBytes(size);
+        EXPECT_NE(a, b);
+        std::vector<size_t> counts(256);
+        for (uint8_t byte : b) {
+            counts[byte]++;
+        }
+        if (size >= 100000) {
+            for (size_t count : counts) {
+                EXPECT_GT(count, size / 256 / 2);
+                EXPECT_LT(count, size / 256 * 2);
+            }
+        }
+    }
+
+    // Every thread has its own generator
+    std::vector<std::vector<uint8_t>> outputs(4);
+#pragma omp parallel for
+    for (size_t i = 0; i < outputs.size(); i++) {
+        outputs[i] = RandomBytes(32);
+    }
+    for (size_t i = 1; i < outputs.size(); i++) {
+        EXPECT_NE(outputs[i], outputs[0]);
+    }
+}
+
 TEST(Hash, Sha256_empty) {
     Sha256 hash;
     std::vector<uint8_t> data = StringToBytes("");
@@ -207,6 +971,136 @@ TEST(Hash, Sha256_small) {
     EXPECT_EQ(hash.GetHash(data), expected);
 }
 
+TEST(Hash, Sha256_MultiBuffer) {
+    std::vector<Sha256::Engine> engines = {Sha256::Engine::Portable};
+    if (GetCpuFeatures().sse2) {
+        engines.push_back(Sha256::Engine::SSE2);
+    }
+    if (GetCpuFeatures().avx2) {
+        engines.push_back(Sha256::Engine::AVX2);
+    }
+    if (GetCpuFeatures().avx512f) {
+        engines.push_back(Sha256::Engine::AVX512);
+    }
+    // Mixed lengths around the padding boundaries, a few long messages and an empty one
+    std::vector<std::vector<uint8_t>> messages;
+    for (size_t i = 0; i < 150; i++) {
+        size_t length = i < 130 ? i : (i - 129) * 1000 + 7;
+        messages.emplace_back(length);
+        for (size_t j = 0; j < length; j++) {
+            messages.back()[j] = j * 13 + i;
+        }
+    }
+    Sha256 reference(Sha256::Engine::Portable, Sha256::Compression::Scalar);
+    for (auto engine : engines) {
+        Sha256 hash(engine);
+        std::vector<std::vector<uint8_t>> digests = hash.GetHashes(messages);
+        ASSERT_EQ(digests.size(), messages.size());
+        for (size_t i = 0; i < messages.size(); i++) {
+            EXPECT_EQ(digests[i], reference.GetHash(messages[i])) << "message " << i;
+        }
+    }
+}
+
+TEST(Hash, Sha256_Compression) {
+    std::vector<Sha256::Compression> compressions = {Sha256::Compression::Scalar};
+    if (GetCpuFeatures().avx2) {
+        compressions.push_back(Sha256::Compression::AVX2);
+    }
+    if (GetCpuFeatures().sha && GetCpuFeatures().ssse3 && GetCpuFeatures().sse41) {
+        compressions.push_back(Sha256::Compression::SHANI);
+    }
+    Sha256 reference(Sha256::Engine::Portable, Sha256::Compression::Scalar);
+    for (auto compression : compressions) {
+        Sha256 hash(Sha256::Engine::Auto, compression);
+        std::vector<uint8_t> data = StringToBytes("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq");
+        EXPECT_EQ(hash.GetHash(data), HexStringToBytes("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"));
+        for (size_t length : {0, 1, 55, 56, 63, 64, 65, 119, 120, 128, 1000, 65536 + 3}) {
+            std::vector<uint8_t> message(length);
+            for (size_t j = 0; j < length; j++) {
+                message[j] = j * 7 + length;
+            }
+            EXPECT_EQ(hash.GetHash(message), reference.GetHash(message)) << "length " << length;
+        }
+    }
+}
+
+TEST(Hash, Kupyna) {
+    // DSTU 7564 examples
+    std::vector<uint8_t> data(64);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = i;
+    }
+    EXPECT_EQ(Kupyna(Kupyna::Size::Kupyna256).GetHash(data),
+              HexStringToBytes("08f4ee6f1be6903b324c4e27990cb24ef69dd58dbe84813ee0a52f6631239875"));
+    EXPECT_EQ(Kupyna(Kupyna::Size::Kupyna512).GetHash(data),
+              HexStringToBytes("3813e2109118cdfb5a6d5e72f7208dccc80a2dfb3afdfb02f46992b5edbe536b"
+                               "3560dd1d7e29c6f53978af58b444e37ba685c0dd910533ba5d78efffc13de62a"));
+    EXPECT_EQ(Kupyna(Kupyna::Size::Kupyna256).GetHash({}),
+              HexStringToBytes("cd5101d1ccdf0d1d1f4ada56e888cd724ca1a0838a3521e7131d4fb78d0f5eb6"));
+}
+
+TEST(Hash, Hmac_Sha256) {
+    // RFC 4231 test case 2
+    Sha256 hash;
+    std::vector<uint8_t> expected = HexStringToBytes("5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+    EXPECT_EQ(Hmac(hash, StringToBytes("Jefe"), StringToBytes("what do ya want for nothing?")), expected);
+}
+
+TEST(Hash, Hmac_Kupyna) {
+    // RFC 4231 test case 2 inputs over Kupyna-256
+    Kupyna hash(Kupyna::Size::Kupyna256);
+    std::vector<uint8_t> expected = HexStringToBytes("5a87d4e94de495731cfd6a7ce47f381bde69f95412ed2468642fb39f670fb468");
+    EXPECT_EQ(Hmac(hash, StringToBytes("Jefe"), StringToBytes("what do ya want for nothing?")), expected);
+}
+
+TEST(Hash, Streaming) {
+    std::vector<std::unique_ptr<Hash>> hashes;
+    hashes.push_back(std::make_unique<Sha256>());
+    hashes.push_back(std::make_unique<Sha256>(Sha256::Engine::Portable, Sha256::Compression::Scalar));
+    hashes.push_back(std::make_unique<Kupyna>(Kupyna::Size::Kupyna256));
+    hashes.push_back(std::make_unique<Kupyna>(Kupyna::Size::Kupyna512));
+    std::vector<uint8_t> data(5000);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = i * 31 + 7;
+    }
+    for (auto &hash : hashes) {
+        // Pieces smaller than, equal to and spanning several blocks, ending at every offset of the padding
+        for (size_t length : {0, 1, 63, 64, 65, 115, 116, 127, 128, 1000, 5000}) {
+            std::vector<uint8_t> message(data.begin(), data.begin() + length);
+            std::vector<uint8_t> expected = hash->GetHash(message);
+            for (size_t piece : {1, 7, 64, 100, 4096}) {
+                for (size_t offset = 0; offset < length; offset += piece) {
+                    hash->Update(message.data() + offset, std::min(piece, length - offset));
+                }
+                EXPECT_EQ(hash->Final(), expected) << "length " << length << ", piece " << piece;
+            }
+        }
+        hash->Update(data.data(), 100);
+        hash->Reset();
+        hash->Update(data.data(), 10);
+        EXPECT_EQ(hash->Final(), hash->GetHash(std::vector<uint8_t>(data.begin(), data.begin() + 10)));
+    }
+}
+
+TEST(Hash, HashFile) {
+    // A little over one read
+    std::vector<uint8_t> data(1024 * 1024 + 123);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = i * 17 + (i >> 12);
+    }
+    {
+        std::ofstream out("crypto330_plain.bin", std::ios_base::binary);
+        out.write(reinterpret_cast<const char *>(data.data()), data.size());
+    }
+    Sha256 sha;
+    Kupyna kupyna;
+    EXPECT_EQ(HashFile(sha, "crypto330_plain.bin"), sha.GetHash(data));
+    EXPECT_EQ(HashFile(kupyna, "crypto330_plain.bin"), kupyna.GetHash(data));
+    std::remove("crypto330_plain.bin");
+    EXPECT_TRUE(HashFile(sha, "crypto330_plain.bin").empty());
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();